@@ -0,0 +1,222 @@
+#include "plugin.hpp"
+#include <chrono>
+
+/**
+ * Headless benchmark for the process()-methods of PackOne's DSP modules.
+ *
+ * Modules are instantiated without any ModuleWidget on a minimal Rack Context which
+ * only provides an engine for sample rate queries. Each module is driven for the given
+ * number of frames and the average time per sample is reported.
+ *
+ * Usage: make bench BENCH_ARGS="[options]"
+ *   --module <slug>     Run only the given module, can be used multiple times (default: all)
+ *   --frames <n>        Number of frames to process, in millions (default: 1)
+ *   --channels <n>      Polyphony of the connected inputs (default: 16)
+ *   --inputs <set>      Connected inputs: "all", "none" or comma separated ids (default: all)
+ *   --outputs <set>     Connected outputs: "all", "none" or comma separated ids (default: all)
+ *   --samplerate <n>    Engine sample rate (default: 48000)
+ *   --json <file>       Write the results as JSON to the file, "-" for stdout
+ *   --list              List available modules
+ */
+
+namespace StoermelderPackOne {
+namespace Bench {
+
+struct BenchModel {
+	std::string slug;
+	Model* model;
+};
+
+static std::vector<BenchModel> benchModels() {
+	// Modules which can be processed without a running UI, i.e. without
+	// accessing APP->scene or APP->event from the engine thread.
+	return {
+		{ "Affix", modelAffix },
+		{ "AffixMicro", modelAffixMicro },
+		{ "Arena", modelArena },
+		{ "Bolt", modelBolt },
+		{ "Dirt", modelDirt },
+		{ "FourRounds", modelFourRounds },
+		{ "Hive", modelHive },
+		{ "Intermix", modelIntermix },
+		{ "Maze", modelMaze },
+		{ "Orbit", modelOrbit },
+		{ "Pile", modelPile },
+		{ "PilePoly", modelPilePoly },
+		{ "Raw", modelRaw },
+		{ "ReMoveLite", modelReMoveLite },
+		{ "RotorA", modelRotorA },
+		{ "Sipo", modelSipo },
+	};
+}
+
+struct BenchOptions {
+	std::set<std::string> modules;
+	double frames = 1e6;
+	int channels = 16;
+	std::string inputs = "all";
+	std::string outputs = "all";
+	float sampleRate = 48000.f;
+	std::string json;
+	bool list = false;
+};
+
+struct BenchResult {
+	std::string slug;
+	int channels;
+	int inputsConnected;
+	int outputsConnected;
+	int64_t frames;
+	double nsPerSample;
+	double cpuPercent;
+};
+
+static std::set<int> parsePortSet(const std::string& s, int count) {
+	std::set<int> ids;
+	if (s == "none") return ids;
+	if (s == "all") {
+		for (int i = 0; i < count; i++) ids.insert(i);
+		return ids;
+	}
+	for (const std::string& t : string::split(s, ",")) {
+		int id = std::atoi(t.c_str());
+		if (id >= 0 && id < count) ids.insert(id);
+	}
+	return ids;
+}
+
+static BenchResult run(const BenchModel& bm, const BenchOptions& opt) {
+	engine::Module* m = bm.model->createModule();
+
+	engine::Module::SampleRateChangeEvent eSampleRate;
+	eSampleRate.sampleRate = opt.sampleRate;
+	eSampleRate.sampleTime = 1.f / opt.sampleRate;
+	m->onSampleRateChange(eSampleRate);
+
+	// Port::isConnected() relies on the channel count only, so a port is "connected"
+	// as soon as it has at least one channel, Port::setChannels() can't be used here
+	std::set<int> inputIds = parsePortSet(opt.inputs, (int)m->inputs.size());
+	for (int id : inputIds) {
+		m->inputs[id].channels = opt.channels;
+		for (int c = 0; c < opt.channels; c++) {
+			m->inputs[id].setVoltage(random::uniform() * 10.f - 5.f, c);
+		}
+	}
+	std::set<int> outputIds = parsePortSet(opt.outputs, (int)m->outputs.size());
+	for (int id : outputIds) {
+		m->outputs[id].channels = 1;
+	}
+
+	engine::Module::ProcessArgs args;
+	args.sampleRate = opt.sampleRate;
+	args.sampleTime = 1.f / opt.sampleRate;
+
+	int64_t frames = (int64_t)opt.frames;
+	auto t0 = std::chrono::steady_clock::now();
+	for (int64_t i = 0; i < frames; i++) {
+		args.frame = i;
+		m->process(args);
+	}
+	auto t1 = std::chrono::steady_clock::now();
+	delete m;
+
+	BenchResult r;
+	r.slug = bm.slug;
+	r.channels = opt.channels;
+	r.inputsConnected = (int)inputIds.size();
+	r.outputsConnected = (int)outputIds.size();
+	r.frames = frames;
+	r.nsPerSample = std::chrono::duration<double, std::nano>(t1 - t0).count() / frames;
+	r.cpuPercent = r.nsPerSample / (1e9 / opt.sampleRate) * 100.0;
+	return r;
+}
+
+static void writeJson(const std::vector<BenchResult>& results, const BenchOptions& opt) {
+	json_t* rootJ = json_object();
+	json_object_set_new(rootJ, "plugin", json_string("Stoermelder-P1"));
+	json_object_set_new(rootJ, "sampleRate", json_real(opt.sampleRate));
+	json_t* resultsJ = json_array();
+	for (const BenchResult& r : results) {
+		json_t* resultJ = json_object();
+		json_object_set_new(resultJ, "module", json_string(r.slug.c_str()));
+		json_object_set_new(resultJ, "channels", json_integer(r.channels));
+		json_object_set_new(resultJ, "inputsConnected", json_integer(r.inputsConnected));
+		json_object_set_new(resultJ, "outputsConnected", json_integer(r.outputsConnected));
+		json_object_set_new(resultJ, "frames", json_integer(r.frames));
+		json_object_set_new(resultJ, "nsPerSample", json_real(r.nsPerSample));
+		json_object_set_new(resultJ, "cpuPercent", json_real(r.cpuPercent));
+		json_array_append_new(resultsJ, resultJ);
+	}
+	json_object_set_new(rootJ, "results", resultsJ);
+
+	if (opt.json == "-") {
+		json_dumpf(rootJ, stdout, JSON_INDENT(2) | JSON_REAL_PRECISION(9));
+		std::printf("\n");
+	}
+	else {
+		FILE* file = std::fopen(opt.json.c_str(), "w");
+		if (file) {
+			json_dumpf(rootJ, file, JSON_INDENT(2) | JSON_REAL_PRECISION(9));
+			std::fclose(file);
+		}
+		else {
+			std::fprintf(stderr, "Could not write %s\n", opt.json.c_str());
+		}
+	}
+	json_decref(rootJ);
+}
+
+static int benchMain(int argc, char* argv[]) {
+	BenchOptions opt;
+	for (int i = 1; i < argc; i++) {
+		std::string a = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (a == "--list") opt.list = true;
+		else if (a == "--module" && hasValue) opt.modules.insert(argv[++i]);
+		else if (a == "--frames" && hasValue) opt.frames = std::atof(argv[++i]) * 1e6;
+		else if (a == "--channels" && hasValue) opt.channels = clamp(std::atoi(argv[++i]), 1, PORT_MAX_CHANNELS);
+		else if (a == "--inputs" && hasValue) opt.inputs = argv[++i];
+		else if (a == "--outputs" && hasValue) opt.outputs = argv[++i];
+		else if (a == "--samplerate" && hasValue) opt.sampleRate = std::atof(argv[++i]);
+		else if (a == "--json" && hasValue) opt.json = argv[++i];
+		else {
+			std::fprintf(stderr, "Unknown argument %s\n", a.c_str());
+			return 1;
+		}
+	}
+
+	if (opt.list) {
+		for (const BenchModel& bm : benchModels()) std::printf("%s\n", bm.slug.c_str());
+		return 0;
+	}
+
+	random::init();
+	Context* context = new Context;
+	contextSet(context);
+	context->engine = new engine::Engine;
+	context->engine->setSuggestedSampleRate(opt.sampleRate);
+
+	std::vector<BenchResult> results;
+	bool quiet = opt.json == "-";
+	if (!quiet) std::printf("%-12s %8s %8s %8s %12s %8s\n", "module", "channels", "inputs", "outputs", "ns/sample", "cpu %");
+	for (const BenchModel& bm : benchModels()) {
+		if (!opt.modules.empty() && opt.modules.find(bm.slug) == opt.modules.end()) continue;
+		BenchResult r = run(bm, opt);
+		results.push_back(r);
+		if (!quiet) std::printf("%-12s %8d %8d %8d %12.2f %8.3f\n", r.slug.c_str(), r.channels, r.inputsConnected, r.outputsConnected, r.nsPerSample, r.cpuPercent);
+	}
+
+	if (!opt.json.empty()) writeJson(results, opt);
+
+	delete context;
+	contextSet(NULL);
+	return 0;
+}
+
+} // namespace Bench
+} // namespace StoermelderPackOne
+
+
+int main(int argc, char* argv[]) {
+	return StoermelderPackOne::Bench::benchMain(argc, argv);
+}
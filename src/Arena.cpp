@@ -9,6 +9,7 @@ namespace Arena {
 
 static const int SEQ_COUNT = 16;
 static const int SEQ_LENGTH = 128;
+static const int SEQ_LUT_LENGTH = 1024;
 
 enum MODMODE {
 	RADIUS = 0,
@@ -52,10 +53,22 @@ enum OUTPUTMODE {
 	FOLD_BI = 5
 };
 
+struct SeqLut {
+	float x[SEQ_LUT_LENGTH + 1];
+	float y[SEQ_LUT_LENGTH + 1];
+};
+
 struct SeqItem {
 	float x[SEQ_LENGTH];
 	float y[SEQ_LENGTH];
 	int length = 0;
+	/**
+	 * Interpolated positions for phase-driven motion, must be marked dirty after any change.
+	 * Allocated on the first phase-driven use of the sequence only.
+	 */
+	std::unique_ptr<SeqLut> lut;
+	SEQINTERPOLATE lutInterpolate;
+	bool lutDirty = true;
 };
 
 
@@ -130,6 +143,8 @@ struct ArenaModule : Module {
 	/** [Stored to JSON] */
 	bool mixportYBipolar[MIX_PORTS];
 	/** [Stored to JSON] */
+	bool audioRate;
+	/** [Stored to JSON] */
 	int inportsUsed = IN_PORTS;
 	/** [Stored to JSON] */
 	int mixportsUsed = MIX_PORTS;
@@ -147,16 +162,24 @@ struct ArenaModule : Module {
 	int seqCopyPort = -1;
 	int seqCopySeq = -1;
 
-	float dist[MIX_PORTS][IN_PORTS];
+	alignas(16) float dist[MIX_PORTS][IN_PORTS];
 	float offsetX[IN_PORTS];
 	float offsetY[IN_PORTS];
 
+	/** Weight of every in-port on the mix-ports, including the amount */
+	simd::float_4 mixWeight[MIX_PORTS][IN_PORTS / 4];
+	simd::float_4 mixWeightDelta[MIX_PORTS][IN_PORTS / 4];
+	/** Sum of the weights of every in-port, used for the OUT-ports */
+	simd::float_4 outNorm[IN_PORTS / 4];
+	simd::float_4 outNormDelta[IN_PORTS / 4];
+
 	//float lastInXpos[IN_PORTS];
 	//float lastInYpos[IN_PORTS];
 	//float lastMixXpos[MIX_PORTS];
 	//float lastMixYpos[MIX_PORTS];
 
 	dsp::SchmittTrigger seqTrigger[MIX_PORTS];
+	dsp::ClockDivider processDivider;
 	dsp::ClockDivider lightDivider;
 
 	ArenaModule() {
@@ -190,6 +213,7 @@ struct ArenaModule : Module {
 			configParam(MIX_Y_PARAM + i, -1.f, 1.f, 0.f, string::f("Channel MIX-%i y-pos attenuverter", i + 1), "x");
 		}
 		onReset();
+		processDivider.setDivision(32);
 		lightDivider.setDivision(512);
 	}
 
@@ -211,6 +235,13 @@ struct ArenaModule : Module {
 			seqMode[i] = SEQMODE::TRIG_FWD;
 			seqInterpolate[i] = SEQINTERPOLATE::LINEAR;
 		}
+		for (int k = 0; k < IN_PORTS / 4; k++) {
+			for (int i = 0; i < MIX_PORTS; i++) {
+				mixWeight[i][k] = mixWeightDelta[i][k] = 0.f;
+			}
+			outNorm[k] = outNormDelta[k] = 0.f;
+		}
+		audioRate = true;
 		seqCopyPort = -1;
 		seqCopySeq = -1;
 		Module::onReset();
@@ -225,9 +256,110 @@ struct ArenaModule : Module {
 	}
 
 	void process(const ProcessArgs& args) override {
-		float inNorm[IN_PORTS] = {0.f};
+		for (int i = 0; i < mixportsUsed; i++) {
+			if (inputs[SEQ_INPUT + i].isConnected()) {
+				seqProcess(i);
+			}
+		}
+
+		if (audioRate || processDivider.process()) {
+			int division = audioRate ? 1 : int(processDivider.getDivision());
+			processGeometry(args.sampleTime * division, division);
+		}
+
+		simd::float_4 inLevel[IN_PORTS / 4];
+		for (int j = 0; j < IN_PORTS; j++) {
+			float v = 0.f;
+			if (j < inportsUsed && inputs[IN + j].isConnected()) {
+				v = clamp(inputs[IN + j].getVoltage(), -10.f, 10.f);
+			}
+			inLevel[j / 4][j % 4] = v;
+		}
+
+		for (int i = 0; i < mixportsUsed; i++) {
+			simd::float_4 mix4 = 0.f;
+			for (int k = 0; k < IN_PORTS / 4; k++) {
+				mix4 += mixWeight[i][k] * inLevel[k];
+			}
+			float mix = mix4[0] + mix4[1] + mix4[2] + mix4[3];
+			mix *= params[MIX_VOL_PARAM + i].getValue();
+			outputs[MIX_OUTPUT + i].setVoltage(mix);
+		}
+
+		for (int j = 0; j < inportsUsed; j++) {
+			if (inputs[IN + j].isConnected() && outputs[OUT_OUTPUT + j].isConnected()) {
+				float v = inputs[IN + j].getVoltage();
+				float n = outNorm[j / 4][j % 4];
+				switch (outputMode[j]) {
+					case OUTPUTMODE::SCALE: {
+						v *= n / MIX_PORTS;
+						v = clamp(v, -10.f, 10.f);
+						break;
+					}
+					case OUTPUTMODE::LIMIT: {
+						v *= std::min(n, 1.f);
+						v = clamp(v, -10.f, 10.f);
+						break;
+					}
+					case OUTPUTMODE::CLIP_UNI: {
+						v *= n;
+						v = clamp(v, 0.f, 10.f);
+						break;
+					}
+					case OUTPUTMODE::CLIP_BI: {
+						v *= n;
+						v = clamp(v, -5.f, 5.f);
+						break;
+					}
+					case OUTPUTMODE::FOLD_UNI: {
+						v = clamp(v, 0.f, 10.f) / 10.f * n;
+						float intf;
+						float frac = std::modf(v, &intf);
+						v = int(intf) % 2 == 0 ? frac : (1.f - frac);
+						v *= 10.f;
+						break;
+					}
+					case OUTPUTMODE::FOLD_BI: {
+						v = clamp(v, -5.f, 5.f) / 5.f * n;
+						float intf;
+						float frac = std::modf(v, &intf);
+						v = int(intf) % 2 == 0 ? frac : (frac >= 0.f ? (1.f - frac) : (-1.f - frac));
+						v *= 5.f;
+						break;
+					}
+				}
+				outputs[OUT_OUTPUT + j].setVoltage(v);
+			}
+		}
+
+		if (!audioRate) {
+			for (int i = 0; i < mixportsUsed; i++) {
+				for (int k = 0; k < IN_PORTS / 4; k++) {
+					mixWeight[i][k] += mixWeightDelta[i][k];
+				}
+			}
+			for (int k = 0; k < IN_PORTS / 4; k++) {
+				outNorm[k] += outNormDelta[k];
+			}
+		}
+
+		// Set lights infrequently
+		if (lightDivider.process()) {
+			for (int i = 0; i < IN_PORTS; i++) {
+				lights[IN_SEL_LIGHT + i].setBrightness(selectedType == 0 && selectedId == i);
+			}
+			for (int i = 0; i < MIX_PORTS; i++) {
+				lights[MIX_SEL_LIGHT + i].setBrightness(selectedType == 1 && selectedId == i);
+			}
+		}
+	}
+
+	/** Positions, modulation and the resulting mix weights, called on every sample or
+	 *  every division-th sample with linear interpolation of the weights in between */
+	void processGeometry(float deltaTime, int division) {
+		float walkScale = std::sqrt(float(division));
 		for (int j = 0; j < inportsUsed; j++) {
-			radius[j] = radiusFilter[j].process(args.sampleTime, radiusUi[j]);
+			radius[j] = radiusFilter[j].process(deltaTime, radiusUi[j]);
 
 			offsetX[j] = 0.f;
 			offsetY[j] = 0.f;
@@ -253,7 +385,8 @@ struct ArenaModule : Module {
 					break;
 				}
 				case MODMODE::WALK: {
-					float v = getOpInput(j);
+					// Larger steps on control rate to keep the speed of the random walk
+					float v = getOpInput(j) * walkScale;
 					offsetX[j] = random::normal() / 2000.f * v;
 					offsetY[j] = random::normal() / 2000.f * v;
 					break;
@@ -281,24 +414,28 @@ struct ArenaModule : Module {
 			y += offsetY[j];
 			y = clamp(y, 0.f, 1.f);
 			params[IN_Y_POS + j].setValue(y);
+		}
 
-			if (inputs[IN + j].isConnected()) {
-				float sd = inputs[IN + j].getVoltage();
-				sd = clamp(sd, -10.f, 10.f);
-				sd *= amount[j];
-				inNorm[j] = sd;
-			}
+		// Pack the in-ports once for all mix-ports
+		simd::float_4 inX[IN_PORTS / 4];
+		simd::float_4 inY[IN_PORTS / 4];
+		simd::float_4 inRadius[IN_PORTS / 4];
+		simd::float_4 inAmount[IN_PORTS / 4];
+		simd::float_4 inActive[IN_PORTS / 4];
+		for (int j = 0; j < IN_PORTS; j++) {
+			bool active = j < inportsUsed && inputs[IN + j].isConnected();
+			inX[j / 4][j % 4] = params[IN_X_POS + j].getValue();
+			inY[j / 4][j % 4] = params[IN_Y_POS + j].getValue();
+			inRadius[j / 4][j % 4] = radius[j];
+			inAmount[j / 4][j % 4] = amount[j];
+			inActive[j / 4][j % 4] = active ? 1.f : 0.f;
 		}
 
-		float outNorm[IN_PORTS] = {0.f};
+		simd::float_4 outNormTarget[IN_PORTS / 4] = {};
 		for (int i = 0; i < mixportsUsed; i++) {
-			if (inputs[SEQ_INPUT + i].isConnected()) {
-				seqProcess(i);
-			}
-
 			if (inputs[SEQ_PH_INPUT + i].isConnected()) {
 				float v = clamp(inputs[SEQ_PH_INPUT + i].getVoltage() / 10.f, 0.f, 1.f);
-				Vec d = seqValue(i, v);
+				Vec d = seqValueLut(i, v);
 				params[MIX_X_POS + i].setValue(d.x);
 				params[MIX_Y_POS + i].setValue(d.y);
 			}
@@ -321,88 +458,34 @@ struct ArenaModule : Module {
 
 			float mixX = params[MIX_X_POS + i].getValue();
 			float mixY = params[MIX_Y_POS + i].getValue();
-			Vec mixVec = Vec(mixX, mixY);
-
-			float mix = 0.f;
-			for (int j = 0; j < inportsUsed; j++) {
-				float inX = params[IN_X_POS + j].getValue();
-				float inY = params[IN_Y_POS + j].getValue();
-
-				//if (mixX != lastMixXpos[i] || mixY != lastMixYpos[i] || inX != lastInXpos[j] || inY != lastInYpos[j]) {
-					//lastInXpos[j] = inX;
-					//lastInYpos[j] = inY;
-					Vec inVec = Vec(inX, inY);
-					dist[i][j] = inVec.minus(mixVec).norm();
-				//}
-
-				float r = radius[j];
-				if (inputs[IN + j].isConnected() && dist[i][j] < r) {
-					float s = std::min(1.0f, (r - dist[i][j]) / r * 1.1f);
-					outNorm[j] += s;
-					s *= inNorm[j];
-					mix += s;
-				}
-			}
 
-			//lastMixXpos[i] = mixX;
-			//lastMixYpos[i] = mixY;
-			mix *= params[MIX_VOL_PARAM + i].getValue();
-			outputs[MIX_OUTPUT + i].setVoltage(mix);
-		}
+			for (int k = 0; k < IN_PORTS / 4; k++) {
+				simd::float_4 dx = inX[k] - mixX;
+				simd::float_4 dy = inY[k] - mixY;
+				simd::float_4 d = simd::sqrt(dx * dx + dy * dy);
+				d.store(&dist[i][k * 4]);
 
-		for (int j = 0; j < inportsUsed; j++) {
-			if (inputs[IN + j].isConnected() && outputs[OUT_OUTPUT + j].isConnected()) {
-				float v = inputs[IN + j].getVoltage();
-				switch (outputMode[j]) {
-					case OUTPUTMODE::SCALE: {
-						v *= outNorm[j] / MIX_PORTS;
-						v = clamp(v, -10.f, 10.f);
-						break;
-					}
-					case OUTPUTMODE::LIMIT: {
-						v *= std::min(outNorm[j], 1.f);
-						v = clamp(v, -10.f, 10.f);
-						break;
-					}
-					case OUTPUTMODE::CLIP_UNI: {
-						v *= outNorm[j];
-						v = clamp(v, 0.f, 10.f);
-						break;
-					}
-					case OUTPUTMODE::CLIP_BI: {
-						v *= outNorm[j];
-						v = clamp(v, -5.f, 5.f);
-						break;
-					}
-					case OUTPUTMODE::FOLD_UNI: {
-						v = clamp(v, 0.f, 10.f) / 10.f * outNorm[j];
-						float intf;
-						float frac = std::modf(v, &intf);
-						v = int(intf) % 2 == 0 ? frac : (1.f - frac);
-						v *= 10.f;
-						break;
-					}
-					case OUTPUTMODE::FOLD_BI: {
-						v = clamp(v, -5.f, 5.f) / 5.f * outNorm[j];
-						float intf;
-						float frac = std::modf(v, &intf);
-						v = int(intf) % 2 == 0 ? frac : (frac >= 0.f ? (1.f - frac) : (-1.f - frac));
-						v *= 5.f;
-						break;
-					}
-				}
-				outputs[OUT_OUTPUT + j].setVoltage(v);
+				simd::float_4 r = inRadius[k];
+				simd::float_4 s = simd::fmin(1.f, (r - d) / r * 1.1f);
+				// Division by a zero radius is masked out by d < r
+				s = simd::ifelse((inActive[k] > 0.f) & (d < r), s, 0.f);
+				outNormTarget[k] += s;
+				setWeight(mixWeight[i][k], mixWeightDelta[i][k], s * inAmount[k], division);
 			}
 		}
 
-		// Set lights infrequently
-		if (lightDivider.process()) {
-			for (int i = 0; i < IN_PORTS; i++) {
-				lights[IN_SEL_LIGHT + i].setBrightness(selectedType == 0 && selectedId == i);
-			}
-			for (int i = 0; i < MIX_PORTS; i++) {
-				lights[MIX_SEL_LIGHT + i].setBrightness(selectedType == 1 && selectedId == i);
-			}
+		for (int k = 0; k < IN_PORTS / 4; k++) {
+			setWeight(outNorm[k], outNormDelta[k], outNormTarget[k], division);
+		}
+	}
+
+	inline void setWeight(simd::float_4& weight, simd::float_4& delta, simd::float_4 target, int division) {
+		if (division == 1) {
+			weight = target;
+			delta = 0.f;
+		}
+		else {
+			delta = (target - weight) / float(division);
 		}
 	}
 
@@ -441,9 +524,40 @@ struct ArenaModule : Module {
 	Vec seqValue(int port, float pos) {
 		SeqItem* s = &seqData[port][seqSelected[port]];
 		if (s->length == 0) return Vec(0.5f, 0.5f);
+		return seqInterpolateValue(s, seqInterpolate[port], pos);
+	}
+
+	/** Same as seqValue() but using a lookup table, rebuilt when the sequence has been changed */
+	Vec seqValueLut(int port, float pos) {
+		SeqItem* s = &seqData[port][seqSelected[port]];
+		if (s->length == 0) return Vec(0.5f, 0.5f);
+		if (s->lutDirty || s->lutInterpolate != seqInterpolate[port]) {
+			seqLutBuild(s, seqInterpolate[port]);
+		}
+		float p = pos * SEQ_LUT_LENGTH;
+		int i = std::min(int(p), SEQ_LUT_LENGTH - 1);
+		float mu = p - i;
+		float x = s->lut->x[i] + (s->lut->x[i + 1] - s->lut->x[i]) * mu;
+		float y = s->lut->y[i] + (s->lut->y[i + 1] - s->lut->y[i]) * mu;
+		return Vec(x, y);
+	}
+
+	void seqLutBuild(SeqItem* s, SEQINTERPOLATE interpolate) {
+		if (!s->lut) s->lut.reset(new SeqLut);
+		// Reset the flag first, changes made during the build are caught on next use
+		s->lutDirty = false;
+		s->lutInterpolate = interpolate;
+		for (int i = 0; i <= SEQ_LUT_LENGTH; i++) {
+			Vec d = seqInterpolateValue(s, interpolate, float(i) / SEQ_LUT_LENGTH);
+			s->lut->x[i] = d.x;
+			s->lut->y[i] = d.y;
+		}
+	}
+
+	Vec seqInterpolateValue(SeqItem* s, SEQINTERPOLATE interpolate, float pos) {
 		int l = s->length - 1;
 
-		switch (seqInterpolate[port]) {
+		switch (interpolate) {
 			case SEQINTERPOLATE::LINEAR: {
 				float mu1 = l * pos;
 				float intf;
@@ -574,6 +688,7 @@ struct ArenaModule : Module {
 			seqData[port][seqSelected[port]].y[c] = pY;
 		}
 		seqData[port][seqSelected[port]].length = l;
+		seqData[port][seqSelected[port]].lutDirty = true;
 	}
 
 	void seqPreset(int port, SEQPRESET preset, float x, float y, int parameter) {
@@ -655,6 +770,7 @@ struct ArenaModule : Module {
 				break;
 			}
 		}
+		seqData[port][seqSelected[port]].lutDirty = true;
 	}
 
 	void seqRotate(int port, float angle) {
@@ -666,18 +782,21 @@ struct ArenaModule : Module {
 			seqData[port][seqSelected[port]].x[i] = std::max(0.f, std::min(p.x, 1.f));
 			seqData[port][seqSelected[port]].y[i] = std::max(0.f, std::min(p.y, 1.f));
 		}
+		seqData[port][seqSelected[port]].lutDirty = true;
 	}
 
 	void seqFlipHorizontally(int port) {
 		for (int i = 0; i < seqData[port][seqSelected[port]].length; i++) {
 			seqData[port][seqSelected[port]].y[i] = 1.f - seqData[port][seqSelected[port]].y[i];
 		}
+		seqData[port][seqSelected[port]].lutDirty = true;
 	}
 
 	void seqFlipVertically(int port) {
 		for (int i = 0; i < seqData[port][seqSelected[port]].length; i++) {
 			seqData[port][seqSelected[port]].x[i] = 1.f - seqData[port][seqSelected[port]].x[i];
 		}
+		seqData[port][seqSelected[port]].lutDirty = true;
 	}
 
 	void seqCopy(int port) {
@@ -693,6 +812,7 @@ struct ArenaModule : Module {
 				seqData[port][seqSelected[port]].y[i] = seqData[seqCopyPort][seqCopySeq].y[i];
 			}
 			seqData[port][seqSelected[port]].length = seqData[seqCopyPort][seqCopySeq].length;
+			seqData[port][seqSelected[port]].lutDirty = true;
 		}
 	}
 
@@ -789,6 +909,7 @@ struct ArenaModule : Module {
 
 		json_object_set_new(rootJ, "inportsUsed", json_integer(inportsUsed));
 		json_object_set_new(rootJ, "mixportsUsed", json_integer(mixportsUsed));
+		json_object_set_new(rootJ, "audioRate", json_boolean(audioRate));
 
 		return rootJ;
 	}
@@ -835,11 +956,14 @@ struct ArenaModule : Module {
 					seqData[mixputIndex][seqItemIndex].y[yIndex] = json_real_value(yJ);
 				}
 				seqData[mixputIndex][seqItemIndex].length = yIndex;
+				seqData[mixputIndex][seqItemIndex].lutDirty = true;
 			}
 		}
 
 		inportsUsed = json_integer_value(json_object_get(rootJ, "inportsUsed"));
 		mixportsUsed = json_integer_value(json_object_get(rootJ, "mixportsUsed"));
+		json_t* audioRateJ = json_object_get(rootJ, "audioRate");
+		if (audioRateJ) audioRate = json_boolean_value(audioRateJ);
 	}
 };
 
@@ -2088,6 +2212,7 @@ struct SeqChangeAction : history::ModuleAction {
 			m->seqData[portId][seqId].y[i] = oldSeqY[i];
 		}
 		m->seqData[portId][seqId].length = oldSeqLength;
+		m->seqData[portId][seqId].lutDirty = true;
 	}
 
 	void redo() override {
@@ -2100,6 +2225,7 @@ struct SeqChangeAction : history::ModuleAction {
 			m->seqData[portId][seqId].y[i] = newSeqY[i];
 		}
 		m->seqData[portId][seqId].length = newSeqLength;
+		m->seqData[portId][seqId].lutDirty = true;
 	}
 };
 
@@ -2426,6 +2552,7 @@ struct SeqEditDragWidget : OpaqueWidget {
 				module->seqData[id][seq].x[index] = x;
 				module->seqData[id][seq].y[index] = y;
 				module->seqData[id][seq].length = index + 1;
+				module->seqData[id][seq].lutDirty = true;
 				index++;
 			}
 			timer = now;
@@ -2844,6 +2971,12 @@ struct ArenaWidget : ThemedModuleWidget<ArenaModule<8, 4>> {
 			addInput(createInputCentered<StoermelderPort>(Vec(x, 287.8f), module, MODULE::SEQ_PH_INPUT + i));
 		}
 	}
+
+	void appendContextMenu(Menu* menu) override {
+		ThemedModuleWidget<MODULE>::appendContextMenu(menu);
+		menu->addChild(new MenuSeparator());
+		menu->addChild(createBoolPtrMenuItem("Audio rate processing", "", &module->audioRate));
+	}
 };
 
 } // namespace Arena
@@ -27,6 +27,7 @@ std::string trim(const std::string& s) {
 }
 
 const int MAX_EXPANDERS = 7;
+const int PRESET_EQUALS_MAX_NODES = 256;
 
 enum class SLOTCVMODE {
 	OFF = -1,
@@ -73,7 +74,7 @@ struct EightFaceMk2Module : EightFaceMk2Base<NUM_PRESETS> {
 	int presetCount;
 
 	/** Total number of snapshots including expanders */
-	int presetTotal;
+	int presetTotal = NUM_PRESETS;
 	int presetNext;
 	int presetCopy = -1;
 
@@ -100,6 +101,9 @@ struct EightFaceMk2Module : EightFaceMk2Base<NUM_PRESETS> {
 	bool lightBlink = false;
 
 	EightFaceMk2Base<NUM_PRESETS>* N[MAX_EXPANDERS + 1];
+	/** Settings last passed on to the expanders */
+	CTRLMODE expanderCtrlMode = CTRLMODE::READ;
+	int expanderPanelTheme = -1;
 
 
 	struct BoundModule {
@@ -113,6 +117,23 @@ struct EightFaceMk2Module : EightFaceMk2Base<NUM_PRESETS> {
 
 	/** [Stored to JSON] */
 	std::vector<BoundModule*> boundModules;
+	/** Incremented whenever a BoundModule is added or deleted */
+	int boundModulesVersion = 0;
+
+	struct PresetPlanItem {
+		BoundModule* boundModule;
+		json_t* vJ;
+	};
+
+	/** Bound modules and their stored states of a slot, only used on the worker thread */
+	struct PresetPlan {
+		/** Contents of the slot the plan was made for, holds a reference on each state */
+		std::vector<json_t*> source;
+		int boundModulesVersion = -1;
+		std::vector<PresetPlanItem> items;
+	};
+
+	PresetPlan presetPlan[(MAX_EXPANDERS + 1) * NUM_PRESETS];
 	/** [Stored to JSON] */
 	EightFace::AUTOLOAD autoload = EightFace::AUTOLOAD::OFF;
 
@@ -143,10 +164,14 @@ struct EightFaceMk2Module : EightFaceMk2Base<NUM_PRESETS> {
 		buttonDivider.setDivision(128);
 		boundModulesDivider.setDivision(APP->engine->getSampleRate());
 		lightDivider.setDivision(512);
+		N[0] = this;
+		taskWorker.postHandler = [this](int p) { processWorker(p); };
 		onReset();
 	}
 
 	~EightFaceMk2Module() {
+		// Pending slot loads access the snapshots released below
+		taskWorker.stop();
 		for (int i = 0; i < NUM_PRESETS; i++) {
 			if (BASE::presetSlotUsed[i]) {
 				for (json_t* vJ : BASE::preset[i]) {
@@ -157,6 +182,11 @@ struct EightFaceMk2Module : EightFaceMk2Base<NUM_PRESETS> {
 		for (BoundModule* b : boundModules) {
 			delete b;
 		}
+		for (PresetPlan& plan : presetPlan) {
+			for (json_t* vJ : plan.source) {
+				json_decref(vJ);
+			}
+		}
 	}
 
 	void onReset() override {
@@ -175,6 +205,7 @@ struct EightFaceMk2Module : EightFaceMk2Base<NUM_PRESETS> {
 			delete b;
 		}
 		boundModules.clear();
+		boundModulesVersion++;
 		inChange = false;
 
 		preset = -1;
@@ -219,13 +250,18 @@ struct EightFaceMk2Module : EightFaceMk2Base<NUM_PRESETS> {
 		return &N[n]->textLabel[index % NUM_PRESETS];
 	}
 
-	void process(const Module::ProcessArgs& args) override {
-		if (inChange) return;
+	/**
+	 * Resolves the chain of expanders, only called if the chain has changed
+	 * or the settings must be passed on to the expanders.
+	 */
+	void expanderUpdate() {
+		BASE::expanderChanged = false;
+		expanderCtrlMode = BASE::ctrlMode;
+		expanderPanelTheme = BASE::panelTheme;
 
 		presetTotal = NUM_PRESETS;
 		Module* m = this;
 		EightFaceMk2Base<NUM_PRESETS>* t = this;
-		t->ctrlMode = (CTRLMODE)Module::params[PARAM_RW].getValue();
 		int c = 0;
 		while (true) {
 			N[c] = t;
@@ -244,6 +280,19 @@ struct EightFaceMk2Module : EightFaceMk2Base<NUM_PRESETS> {
 			t->ctrlMode = BASE::ctrlMode;
 			presetTotal += NUM_PRESETS;
 		}
+	}
+
+	void process(const Module::ProcessArgs& args) override {
+		if (inChange) return;
+		taskWorker.postPoll();
+
+		BASE::ctrlMode = (CTRLMODE)Module::params[PARAM_RW].getValue();
+		if (BASE::ctrlMode != expanderCtrlMode || BASE::panelTheme != expanderPanelTheme) {
+			BASE::expanderChanged = true;
+		}
+		if (BASE::expanderChanged) {
+			expanderUpdate();
+		}
 		int presetCount = std::min(this->presetCount, presetTotal);
 
 		// Read mode
@@ -420,6 +469,7 @@ struct EightFaceMk2Module : EightFaceMk2Base<NUM_PRESETS> {
 		auto it = EightFace::guiModuleSlugs.find(std::make_tuple(b->pluginSlug, b->modelSlug));
 		b->needsGuiThread = it != EightFace::guiModuleSlugs.end();
 		boundModules.push_back(b);
+		boundModulesVersion++;
 	}
 
 	void bindModuleExpander() {
@@ -449,34 +499,64 @@ struct EightFaceMk2Module : EightFaceMk2Base<NUM_PRESETS> {
 				break;
 			}
 		}
+		boundModulesVersion++;
 		delete b;
 	}
 
-	void processWorker(int workerPreset) {
-		if (workerPreset < 0) return;
+	/**
+	 * Matches the stored states of a slot against the bound modules. The plan is kept
+	 * until the slot's contents or the bound modules change, so loading a slot needs
+	 * no lookups or string comparisons.
+	 */
+	PresetPlan& presetPlanGet(int p, EightFaceMk2Slot* slot) {
+		PresetPlan& plan = presetPlan[p];
+		if (plan.boundModulesVersion == boundModulesVersion && plan.source == *(slot->preset)) return plan;
+
+		for (json_t* vJ : plan.source) {
+			json_decref(vJ);
+		}
+		plan.source = *(slot->preset);
+		for (json_t* vJ : plan.source) {
+			json_incref(vJ);
+		}
+		plan.boundModulesVersion = boundModulesVersion;
+		plan.items.clear();
 
-		EightFaceMk2Slot* slot = expSlot(workerPreset);
-		for (json_t* vJ : *slot->preset) {
+		for (json_t* vJ : plan.source) {
 			json_t* idJ = json_object_get(vJ, "id");
 			if (!idJ) continue;
 			int64_t moduleId = json_integer_value(idJ);
-			std::string plugin = json_string_value(json_object_get(vJ, "plugin"));
-			std::string model = json_string_value(json_object_get(vJ, "model"));
+			const char* plugin = json_string_value(json_object_get(vJ, "plugin"));
+			const char* model = json_string_value(json_object_get(vJ, "model"));
+			if (!plugin || !model) continue;
 			for (BoundModule* b : boundModules) {
 				if (b->moduleId != moduleId) continue;
 				if (b->pluginSlug != plugin || b->modelSlug != model) break;
-				ModuleWidget* mw = b->getModuleWidget();
-				if (!mw) continue;
-
-				if (b->needsGuiThread) {
-					workerGuiQueue.push(std::make_tuple(mw, vJ));
-				}
-				else {
-					mw->fromJson(vJ);
-				}
+				plan.items.push_back(PresetPlanItem{b, vJ});
 				break;
 			}
 		}
+		return plan;
+	}
+
+	void processWorker(int workerPreset) {
+		if (workerPreset < 0) return;
+
+		EightFaceMk2Slot* slot = expSlot(workerPreset);
+		if (!slot) return;
+		PresetPlan& plan = presetPlanGet(workerPreset, slot);
+		for (PresetPlanItem& item : plan.items) {
+			BoundModule* b = item.boundModule;
+			ModuleWidget* mw = b->getModuleWidget();
+			if (!mw) continue;
+
+			if (b->needsGuiThread) {
+				workerGuiQueue.push(std::make_tuple(mw, item.vJ));
+			}
+			else if (!presetEquals(mw->module, item.vJ)) {
+				mw->fromJson(item.vJ);
+			}
+		}
 	}
 
 	void processGui() {
@@ -484,10 +564,84 @@ struct EightFaceMk2Module : EightFaceMk2Base<NUM_PRESETS> {
 			auto t = workerGuiQueue.shift();
 			ModuleWidget* mw = std::get<0>(t);
 			json_t* vJ = std::get<1>(t);
+			if (presetEquals(mw->module, vJ)) continue;
 			mw->fromJson(vJ);
 		}
 	}
 
+	/**
+	 * Checks if the stored state of a module matches its current state, loading a
+	 * snapshot skips modules which have not been changed since.
+	 */
+	bool presetEquals(Module* m, json_t* vJ) {
+		if (!m) return false;
+		json_t* paramsJ = json_object_get(vJ, "params");
+		json_t* paramJ;
+		size_t paramIndex;
+		json_array_foreach(paramsJ, paramIndex, paramJ) {
+			json_t* idJ = json_object_get(paramJ, "id");
+			size_t paramId = idJ ? json_integer_value(idJ) : paramIndex;
+			if (paramId >= m->params.size()) return false;
+			json_t* valueJ = json_object_get(paramJ, "value");
+			if (!valueJ) continue;
+			if (m->params[paramId].getValue() != (float)json_number_value(valueJ)) return false;
+		}
+		if (m->isBypassed() != json_is_true(json_object_get(vJ, "bypass"))) return false;
+
+		// Serializing modules with large data costs more than loading the snapshot
+		json_t* dataJ = json_object_get(vJ, "data");
+		int budget = PRESET_EQUALS_MAX_NODES;
+		if (!presetJsonSmall(dataJ, budget)) return false;
+		json_t* currentJ = m->dataToJson();
+		bool r = dataJ && currentJ ? json_equal(dataJ, currentJ) : dataJ == currentJ;
+		if (currentJ) json_decref(currentJ);
+		return r;
+	}
+
+	/** Checks if a JSON value has not more nodes than budget */
+	static bool presetJsonSmall(json_t* vJ, int& budget) {
+		if (!vJ) return true;
+		if (--budget < 0) return false;
+		if (json_is_array(vJ)) {
+			json_t* wJ;
+			size_t i;
+			json_array_foreach(vJ, i, wJ) {
+				if (!presetJsonSmall(wJ, budget)) return false;
+			}
+		}
+		else if (json_is_object(vJ)) {
+			const char* key;
+			json_t* wJ;
+			json_object_foreach(vJ, key, wJ) {
+				if (!presetJsonSmall(wJ, budget)) return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * Returns an identical module state from another snapshot if there is one, so
+	 * unchanged modules share their JSON instead of storing a copy in every slot.
+	 */
+	json_t* presetIntern(int p, json_t* vJ) {
+		json_t* idJ = json_object_get(vJ, "id");
+		for (int i = 0; i < presetTotal; i++) {
+			if (i == p) continue;
+			EightFaceMk2Slot* slot = expSlot(i);
+			if (!*(slot->presetSlotUsed)) continue;
+			for (json_t* wJ : *(slot->preset)) {
+				if (!json_equal(json_object_get(wJ, "id"), idJ)) continue;
+				if (json_equal(wJ, vJ)) {
+					json_incref(wJ);
+					json_decref(vJ);
+					return wJ;
+				}
+				break;
+			}
+		}
+		return vJ;
+	}
+
 	void presetLoad(int p, bool isNext = false, bool force = false) {
 		if (p < 0 || p >= presetCount)
 			return;
@@ -498,7 +652,8 @@ struct EightFaceMk2Module : EightFaceMk2Base<NUM_PRESETS> {
 				preset = p;
 				presetNext = -1;
 				if (!*(slot->presetSlotUsed)) return;
-				taskWorker.work([=]() { processWorker(p); });
+				// Only the latest slot is loaded if slots change faster than they load
+				taskWorker.post(p);
 			}
 		}
 		else {
@@ -521,7 +676,7 @@ struct EightFaceMk2Module : EightFaceMk2Base<NUM_PRESETS> {
 			ModuleWidget* mw = b->getModuleWidget();
 			if (!mw) continue;
 			json_t* vJ = mw->toJson();
-			slot->preset->push_back(vJ);
+			slot->preset->push_back(presetIntern(p, vJ));
 		}
 		preset = p;
 	}
@@ -570,7 +725,9 @@ struct EightFaceMk2Module : EightFaceMk2Base<NUM_PRESETS> {
 		auto sourcePreset = sourceSlot->preset;
 		auto targetPreset = targetSlot->preset;
 		for (json_t* vJ : *sourcePreset) {
-			targetPreset->push_back(json_deep_copy(vJ));
+			// Stored states are never modified, the copy can share them
+			json_incref(vJ);
+			targetPreset->push_back(vJ);
 		}
 		if (preset == target) preset = -1;
 	}
@@ -688,6 +845,7 @@ struct EightFaceMk2Module : EightFaceMk2Base<NUM_PRESETS> {
 			delete b;
 		}
 		boundModules.clear();
+		boundModulesVersion++;
 
 		json_t* boundModulesJ = json_object_get(rootJ, "boundModules");
 		if (boundModulesJ) {
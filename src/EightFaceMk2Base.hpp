@@ -47,6 +47,8 @@ struct EightFaceMk2Base : Module, StripIdFixModule {
 
 	int64_t ctrlModuleId = -1;
 	int ctrlOffset = 0;
+	/** Set if the chain of expanders must be resolved again */
+	bool expanderChanged = true;
 	/** Current operating mode */
 	CTRLMODE ctrlMode = CTRLMODE::READ;
 
@@ -56,6 +58,19 @@ struct EightFaceMk2Base : Module, StripIdFixModule {
 
 	virtual int faceSlotCmd(SLOT_CMD cmd, int i) { return -1; }
 
+	void onExpanderChange(const Module::ExpanderChangeEvent& e) override {
+		// Only the direct neighbours get notified, pass the change on to the
+		// controlling module on the left end of the chain
+		Module* m = this;
+		while (m->model == modelEightFaceMk2Ex) {
+			m = m->leftExpander.module;
+			if (!m) return;
+		}
+		if (m->model == modelEightFaceMk2) {
+			reinterpret_cast<EightFaceMk2Base<NUM_PRESETS>*>(m)->expanderChanged = true;
+		}
+	}
+
 
 	json_t* dataToJson() override {
 		json_t* rootJ = json_object();
@@ -80,6 +95,28 @@ struct EightFaceMk2Base : Module, StripIdFixModule {
 		return rootJ;
 	}
 
+	/**
+	 * Returns an identical module state from a previously loaded slot if there is one,
+	 * so unchanged modules share their JSON after loading as they do after saving a slot.
+	 */
+	json_t* presetInternLoaded(int p, json_t* vJ) {
+		json_t* idJ = json_object_get(vJ, "id");
+		for (int i = 0; i < p; i++) {
+			if (!presetSlotUsed[i]) continue;
+			for (json_t* wJ : preset[i]) {
+				if (!json_equal(json_object_get(wJ, "id"), idJ)) continue;
+				if (json_equal(wJ, vJ)) {
+					json_incref(wJ);
+					return wJ;
+				}
+				break;
+			}
+		}
+		// The parsed patch is released after loading, the entry is taken without copying it
+		json_incref(vJ);
+		return vJ;
+	}
+
 	void dataFromJson(json_t* rootJ) override {
 		panelTheme = json_integer_value(json_object_get(rootJ, "panelTheme"));
 
@@ -96,7 +133,7 @@ struct EightFaceMk2Base : Module, StripIdFixModule {
 				json_t* vJ;
 				size_t j;
 				json_array_foreach(slotJ, j, vJ) {
-					preset[presetIndex].push_back(json_deep_copy(vJ));
+					preset[presetIndex].push_back(presetInternLoaded(presetIndex, vJ));
 				}
 			}
 		}
@@ -8,6 +8,8 @@ namespace StoermelderPackOne {
 namespace Intermix {
 
 const int SCENE_MAX = 8;
+/** Ratio of non-zero weights in the matrix below which the sparse mixing kernel is used */
+const float MIX_SPARSE_DENSITY = 0.25f;
 
 enum SCENE_CV_MODE {
 	OFF = -1,
@@ -90,6 +92,20 @@ struct IntermixModule : Module, IntermixBase<PORTS> {
 
 	alignas(16) float currentMatrix[PORTS][PORTS];
 
+	/** Mixing weights used while no fade is running, disabled outputs are zeroed */
+	alignas(16) float mixMatrix[PORTS][PORTS];
+	/** Contribution of inputs set to constant voltage, equal for all channels */
+	alignas(16) float mixOffset[PORTS];
+	/** Input modes the mixing weights have been built for */
+	IN_MODE mixInputMode[PORTS];
+	/** Outputs with non-zero weight for every input, empty for inputs not read */
+	int mixRow[PORTS][PORTS];
+	int mixRowLength[PORTS];
+	bool mixSparse = false;
+	bool mixDirty = true;
+	/** Faders of the input have been triggered and did not reach their target yet */
+	bool fadeActive[PORTS];
+
 	/** [Stored to JSON] */
 	int panelTheme = 0;
 
@@ -178,7 +194,11 @@ struct IntermixModule : Module, IntermixBase<PORTS> {
 		sceneAtMode = true;
 		sceneCount = SCENE_MAX;
 		sceneLock = false;
+		for (int i = 0; i < PORTS; i++) {
+			fadeActive[i] = false;
+		}
 		sceneSet(0);
+		mixDirty = true;
 		Module::onReset();
 	}
 
@@ -262,8 +282,12 @@ struct IntermixModule : Module, IntermixBase<PORTS> {
 			for (int i = 0; i < PORTS; i++) {
 				bool fadeIn = ts - fadeInTs[i] > sceneDivider.getDivision() * 2;
 				bool fadeOut = ts - fadeOutTs[i] > sceneDivider.getDivision() * 2;
-				scenes[sceneSelected].output[i] = params[PARAM_OUTPUT + i].getValue() == 0.f ? OM_OUT : OM_OFF;
+				OUT_MODE output = params[PARAM_OUTPUT + i].getValue() == 0.f ? OM_OUT : OM_OFF;
+				if (output != scenes[sceneSelected].output[i]) mixDirty = true;
+				scenes[sceneSelected].output[i] = output;
 				scenes[sceneSelected].outputAt[i] = params[PARAM_AT + i].getValue();
+				IN_MODE mode = sceneInputMode ? scenes[sceneSelected].input[i] : inputMode[i];
+				if (mode != mixInputMode[i]) mixDirty = true;
 				for (int j = 0; j < PORTS; j++) {
 					float p = params[PARAM_MATRIX + j * PORTS + i].getValue();
 					for (int c = 0; c < channelCount; c++) {
@@ -272,75 +296,49 @@ struct IntermixModule : Module, IntermixBase<PORTS> {
 						if (p != scenes[sceneSelected].matrix[i][j] && p == 1.f) fader[i][j][c].triggerFadeIn();
 						if (p != scenes[sceneSelected].matrix[i][j] && p == 0.f) fader[i][j][c].triggerFadeOut();
 					}
+					if (p != scenes[sceneSelected].matrix[i][j]) {
+						fadeActive[i] = true;
+						mixDirty = true;
+					}
 					scenes[sceneSelected].matrix[i][j] = p;
-					IN_MODE mode = sceneInputMode ? scenes[sceneSelected].input[i] : inputMode[i];
 					if (mode != IN_MODE::IM_FADE) currentMatrix[i][j] = p;
 				}
 			}
-		}
 
-		// DSP processing
-		for (int c = 0; c < channelCount; c++) {
-			simd::float_4 out[PORTS / 4] = {};
+			// Faders are checked at control rate only, the per-sample path simply
+			// keeps running a few samples longer than necessary
 			for (int i = 0; i < PORTS; i++) {
-				float v;
-				IN_MODE mode = sceneInputMode ? scenes[sceneSelected].input[i] : inputMode[i];
-				switch (mode) {
-					case IN_MODE::IM_OFF:
-						continue;
-					case IN_MODE::IM_DIRECT:
-						if (!inputs[INPUT + i].isConnected()) continue;
-						v = inputs[INPUT + i].getPolyVoltage(c);
-						break;
-					case IN_MODE::IM_FADE:
-						if (!inputs[INPUT + i].isConnected()) continue;
-						v = inputs[INPUT + i].getPolyVoltage(c);
-						for (int j = 0; j < PORTS; j++) {
-							currentMatrix[i][j] = fader[i][j][c].process(args.sampleTime);
-						}
-						break;
-					default:
-						v = (mode - 24) / 12.f;
-						break;
+				if (!fadeActive[i]) continue;
+				if (mixInputMode[i] != IN_MODE::IM_FADE) continue;
+				bool active = false;
+				for (int j = 0; j < PORTS; j++) {
+					for (int c = 0; c < channelCount; c++) {
+						active = active || fader[i][j][c].isActive();
+					}
 				}
-
-				for (int j = 0; j < PORTS; j+=4) {
-					simd::float_4 v1 = simd::float_4::load(&currentMatrix[i][j]);
-					simd::float_4 v2 = v1 * simd::float_4(v);
-					out[j / 4] += v2;
+				if (!active) {
+					fadeActive[i] = false;
+					mixDirty = true;
 				}
 			}
+		}
 
+		// DSP processing
+		if (mixDirty) mixRebuild();
 
-			// -- Standard code --
-			/*
-			for (int i = 0; i < PORTS; i++) {
-				float v = scenes[sceneSelected].output[i] == OM_OUT ? out[i / 4][i % 4] : 0.f;
-				if (outputClamp) v = clamp(v, -10.f, 10.f);
-				outputs[OUTPUT + i].setVoltage(v);
-			}
-			*/
-			// -- Standard code --
-
-			// -- SIMD code --
-			simd::float_4 oc = outputClamp;
-			for (int j = 0; j < PORTS; j+=4) {
-				// Check for OUT_MODE
-				simd::int32_4 o1 = simd::int32_4::load((int32_t*)&scenes[sceneSelected].output[j]);
-				simd::float_4 o2 = simd::float_4(o1 != 0) == -1.f;
-				out[j / 4] = simd::ifelse(o2, out[j / 4], simd::float_4::zero());
-				// Clamp if outputClamp it set
-				out[j / 4] = simd::ifelse(oc == 1.f, simd::clamp(out[j / 4], -10.f, 10.f), out[j / 4]);
-				// Attenuverters
-				simd::float_4 at = simd::float_4::load(&scenes[sceneSelected].outputAt[j]);
-				//at = outputAtSlew[j / 4].process(args.sampleTime, at);
-				out[j / 4] *= at;
+		bool fading = false;
+		for (int i = 0; i < PORTS; i++) {
+			if (fadeActive[i] && mixInputMode[i] == IN_MODE::IM_FADE && inputs[INPUT + i].isConnected()) {
+				fading = true;
+				break;
 			}
+		}
 
-			for (int i = 0; i < PORTS; i++) {
-				outputs[OUTPUT + i].setVoltage(out[i / 4][i % 4], c);
-			}
-			// -- SIMD code --
+		if (fading) {
+			processFading(args);
+		}
+		else {
+			processStatic(args);
 		}
 
 		for (int i = 0; i < PORTS; i++) {
@@ -392,6 +390,126 @@ struct IntermixModule : Module, IntermixBase<PORTS> {
 		rightExpander.messageFlipRequested = true;
 	}
 
+	/** Per-sample processing while faders are running, the weights are re-evaluated for every channel */
+	inline void processFading(const ProcessArgs& args) {
+		for (int c = 0; c < channelCount; c += 4) {
+			simd::float_4 out[PORTS] = {};
+			for (int i = 0; i < PORTS; i++) {
+				simd::float_4 v;
+				IN_MODE mode = sceneInputMode ? scenes[sceneSelected].input[i] : inputMode[i];
+				switch (mode) {
+					case IN_MODE::IM_OFF:
+						continue;
+					case IN_MODE::IM_DIRECT:
+						if (!inputs[INPUT + i].isConnected()) continue;
+						v = inputs[INPUT + i].getPolyVoltageSimd<simd::float_4>(c);
+						break;
+					case IN_MODE::IM_FADE: {
+						if (!inputs[INPUT + i].isConnected()) continue;
+						v = inputs[INPUT + i].getPolyVoltageSimd<simd::float_4>(c);
+						int n = std::min(channelCount - c, 4);
+						for (int j = 0; j < PORTS; j++) {
+							simd::float_4 w = 0.f;
+							for (int k = 0; k < n; k++) {
+								w[k] = fader[i][j][c + k].process(args.sampleTime);
+							}
+							currentMatrix[i][j] = w[n - 1];
+							out[j] += w * v;
+						}
+						continue;
+					}
+					default:
+						v = (mode - 24) / 12.f;
+						break;
+				}
+
+				for (int j = 0; j < PORTS; j++) {
+					out[j] += currentMatrix[i][j] * v;
+				}
+			}
+			processOutput(out, c);
+		}
+	}
+
+	/** Processing using the prepared weights of the current scene */
+	inline void processStatic(const ProcessArgs& args) {
+		for (int c = 0; c < channelCount; c += 4) {
+			// Gather four channels of every input
+			simd::float_4 in[PORTS];
+			bool inRead[PORTS];
+			for (int i = 0; i < PORTS; i++) {
+				inRead[i] = mixRowLength[i] > 0 && inputs[INPUT + i].isConnected();
+				if (inRead[i]) in[i] = inputs[INPUT + i].getPolyVoltageSimd<simd::float_4>(c);
+			}
+
+			simd::float_4 out[PORTS];
+			for (int j = 0; j < PORTS; j++) {
+				out[j] = mixOffset[j];
+			}
+			if (mixSparse) {
+				// Only the routes set in the matrix are evaluated
+				for (int i = 0; i < PORTS; i++) {
+					if (!inRead[i]) continue;
+					for (int k = 0; k < mixRowLength[i]; k++) {
+						int j = mixRow[i][k];
+						out[j] += mixMatrix[i][j] * in[i];
+					}
+				}
+			}
+			else {
+				for (int i = 0; i < PORTS; i++) {
+					if (!inRead[i]) continue;
+					for (int j = 0; j < PORTS; j++) {
+						out[j] += mixMatrix[i][j] * in[i];
+					}
+				}
+			}
+			processOutput(out, c);
+		}
+	}
+
+	/** Applies OUT_MODE, clamping and attenuverters to four channels of every output */
+	inline void processOutput(simd::float_4* out, int c) {
+		for (int j = 0; j < PORTS; j++) {
+			simd::float_4 v = scenes[sceneSelected].output[j] == OM_OUT ? out[j] : simd::float_4::zero();
+			if (outputClamp) v = simd::clamp(v, -10.f, 10.f);
+			v *= scenes[sceneSelected].outputAt[j];
+			outputs[OUTPUT + j].setVoltageSimd(v, c);
+		}
+	}
+
+	void mixRebuild() {
+		int nonZero = 0;
+		for (int j = 0; j < PORTS; j++) {
+			mixOffset[j] = 0.f;
+		}
+		for (int i = 0; i < PORTS; i++) {
+			IN_MODE mode = sceneInputMode ? scenes[sceneSelected].input[i] : inputMode[i];
+			mixInputMode[i] = mode;
+			mixRowLength[i] = 0;
+			for (int j = 0; j < PORTS; j++) {
+				float w = scenes[sceneSelected].output[j] == OM_OUT ? currentMatrix[i][j] : 0.f;
+				switch (mode) {
+					case IN_MODE::IM_OFF:
+						mixMatrix[i][j] = 0.f;
+						break;
+					case IN_MODE::IM_DIRECT:
+					case IN_MODE::IM_FADE:
+						mixMatrix[i][j] = w;
+						if (w != 0.f) mixRow[i][mixRowLength[i]++] = j;
+						break;
+					default:
+						mixMatrix[i][j] = 0.f;
+						mixOffset[j] += w * (mode - 24) / 12.f;
+						break;
+				}
+			}
+			nonZero += mixRowLength[i];
+		}
+		mixSparse = nonZero < MIX_SPARSE_DENSITY * PORTS * PORTS;
+		mixDirty = false;
+	}
+
 	inline void sceneSet(int scene) {
 		if (sceneSelected == scene) return;
 		if (scene < 0) return;
@@ -426,9 +544,11 @@ struct IntermixModule : Module, IntermixBase<PORTS> {
 					if (p != scenes[scenePrevious].matrix[i][j] && p == 1.f) fader[i][j][c].triggerFadeIn();
 					if (p != scenes[scenePrevious].matrix[i][j] && p == 0.f) fader[i][j][c].triggerFadeOut();
 				}
+				if (p != scenes[scenePrevious].matrix[i][j]) fadeActive[i] = true;
 				currentMatrix[i][j] = p;
 			}
 		}
+		mixDirty = true;
 		/*
 		for (int i = 0; i < PORTS / 4; i++) {
 			outputAtSlew[i].setRiseFall(at[i] / f1, at[i] / f2);
@@ -464,11 +584,13 @@ struct IntermixModule : Module, IntermixBase<PORTS> {
 				}
 			}
 		}
+		mixDirty = true;
 	}
 
 	void sceneSetCount(int count) {
 		sceneCount = count;
 		sceneSelected = std::min(sceneSelected, sceneCount - 1);
+		mixDirty = true;
 	}
 
 	typename IntermixBase<PORTS>::IntermixMatrix expGetCurrentMatrix() override {
@@ -604,7 +726,9 @@ struct IntermixModule : Module, IntermixBase<PORTS> {
 					fader[i][j][c].reset(v);
 				}
 			}
+			fadeActive[i] = false;
 		}
+		mixDirty = true;
 	}
 };
 
@@ -9,15 +9,46 @@
 #include "ui/ParamWidgetContextExtender.hpp"
 #include "ui/OverlayMessageWidget.hpp"
 #include <osdialog.h>
+#include <bitset>
+#include <atomic>
 
 namespace StoermelderPackOne {
 namespace MidiCat {
 
 static const char PRESET_FILTERS[] = "VCV Rack module preset (.vcvm):vcvm";
 
+/**
+ * MIDI output for feedback messages. Messages are not sent immediately but queued per
+ * CC and note number, so a value changing several times before it is sent results in
+ * a single message. Queued messages are sent within a budget of messages per second.
+ */
 struct MidiCatOutput : midi::Output {
+	/** Messages per second used for re-sending feedback if there is no limit */
+	static constexpr float RESEND_RATE = 1000.f;
+
+	enum PRIORITY {
+		NONE = 0,
+		LOW = 1,
+		HIGH = 2
+	};
+
+	/** [Stored to JSON] Maximum number of messages per second, 0 for no limit */
+	int rateLimit = 0;
+
 	int lastValues[128];
 	bool lastGates[128];
+	/** Velocity of the last note message, -1 if none has been sent yet */
+	int lastVelocities[128];
+	bool lastNoteOffVelocityZero[128];
+
+	/** Queued messages, CC numbers are stored at 0-127, note numbers at 128-255 */
+	int pendingValues[256];
+	bool pendingForce[256];
+	PRIORITY pendingPriority[256];
+	int pendingCount[3];
+	int pendingCursor[3];
+	float tokens = 0.f;
+	std::atomic<bool> resendRequested{false};
 
 	MidiCatOutput() {
 		reset();
@@ -27,43 +58,137 @@ struct MidiCatOutput : midi::Output {
 		for (int n = 0; n < 128; n++) {
 			lastValues[n] = -1;
 			lastGates[n] = false;
+			lastVelocities[n] = -1;
+			lastNoteOffVelocityZero[n] = false;
+		}
+		for (int k = 0; k < 256; k++) {
+			pendingValues[k] = -1;
+			pendingForce[k] = false;
+			pendingPriority[k] = PRIORITY::NONE;
+		}
+		for (int i = 0; i < 3; i++) {
+			pendingCount[i] = 0;
+			pendingCursor[i] = 0;
 		}
+		tokens = 0.f;
+		resendRequested = false;
 	}
 
 	void setValue(int value, int cc, bool force = false) {
-		if (value == lastValues[cc] && !force)
-			return;
-		lastValues[cc] = value;
-		// CC
-		midi::Message m;
-		m.setStatus(0xb);
-		m.setNote(cc);
-		m.setValue(value);
-		sendMessage(m);
+		enqueue(cc, value, force, PRIORITY::HIGH);
 	}
 
 	void setGate(int vel, int note, bool noteOffVelocityZero, bool force = false) {
-		if (vel > 0) {
+		lastNoteOffVelocityZero[note] = noteOffVelocityZero;
+		enqueue(128 + note, vel, force, PRIORITY::HIGH);
+	}
+
+	/** Queues all previously sent values with low priority, can be called from any thread */
+	void resendFeedback() {
+		resendRequested = true;
+	}
+
+	void enqueue(int key, int value, bool force, PRIORITY priority) {
+		pendingValues[key] = value;
+		pendingForce[key] = pendingForce[key] || force;
+		if (pendingPriority[key] >= priority) return;
+		if (pendingPriority[key] != PRIORITY::NONE) pendingCount[pendingPriority[key]]--;
+		pendingPriority[key] = priority;
+		pendingCount[priority]++;
+	}
+
+	void process(float sampleTime) {
+		if (resendRequested.exchange(false)) {
+			for (int cc = 0; cc < 128; cc++) {
+				if (lastValues[cc] >= 0) enqueue(cc, lastValues[cc], true, PRIORITY::LOW);
+			}
+			for (int note = 0; note < 128; note++) {
+				if (lastVelocities[note] >= 0) enqueue(128 + note, lastVelocities[note], true, PRIORITY::LOW);
+			}
+		}
+
+		// Allow a burst of 10ms worth of messages
+		float rate = rateLimit > 0 ? float(rateLimit) : RESEND_RATE;
+		float burst = 1.f + rate / 100.f;
+		if (pendingCount[PRIORITY::HIGH] == 0 && pendingCount[PRIORITY::LOW] == 0) {
+			tokens = burst;
+			return;
+		}
+		tokens = std::min(tokens + rate * sampleTime, burst);
+
+		// Changed values are sent before re-sent values
+		while (pendingCount[PRIORITY::HIGH] > 0 && (rateLimit == 0 || tokens >= 1.f)) {
+			if (send(next(PRIORITY::HIGH)) && rateLimit > 0) tokens -= 1.f;
+		}
+		while (pendingCount[PRIORITY::HIGH] == 0 && pendingCount[PRIORITY::LOW] > 0 && tokens >= 1.f) {
+			if (send(next(PRIORITY::LOW))) tokens -= 1.f;
+		}
+	}
+
+	/** Returns the next queued key of the priority, round-robin for fairness between controls */
+	int next(PRIORITY priority) {
+		int& c = pendingCursor[priority];
+		while (pendingPriority[c] != priority) c = (c + 1) % 256;
+		int key = c;
+		c = (c + 1) % 256;
+		return key;
+	}
+
+	/** Sends a queued message, returns false if it has been dropped as a duplicate */
+	bool send(int key) {
+		// The MSB of a 14-bit CC must be sent before its LSB
+		if (key >= 32 && key < 64 && pendingPriority[key - 32] != PRIORITY::NONE) {
+			send(key - 32);
+		}
+
+		int value = pendingValues[key];
+		bool force = pendingForce[key];
+		pendingCount[pendingPriority[key]]--;
+		pendingPriority[key] = PRIORITY::NONE;
+		pendingForce[key] = false;
+
+		if (key < 128) {
+			int cc = key;
+			if (value == lastValues[cc] && !force)
+				return false;
+			lastValues[cc] = value;
+			// CC
+			midi::Message m;
+			m.setStatus(0xb);
+			m.setNote(cc);
+			m.setValue(value);
+			sendMessage(m);
+			return true;
+		}
+
+		int note = key - 128;
+		bool sent = false;
+		if (value > 0) {
 			// Note on
 			if (!lastGates[note] || force) {
 				midi::Message m;
 				m.setStatus(0x9);
 				m.setNote(note);
-				m.setValue(vel);
+				m.setValue(value);
 				sendMessage(m);
+				lastVelocities[note] = value;
+				sent = true;
 			}
 		}
-		else if (vel == 0) {
+		else if (value == 0) {
 			// Note off
 			if (lastGates[note] || force) {
 				midi::Message m;
-				m.setStatus(noteOffVelocityZero ? 0x9 : 0x8);
+				m.setStatus(lastNoteOffVelocityZero[note] ? 0x9 : 0x8);
 				m.setNote(note);
 				m.setValue(0);
 				sendMessage(m);
+				lastVelocities[note] = 0;
+				sent = true;
 			}
 		}
-		lastGates[note] = vel > 0;
+		lastGates[note] = value > 0;
+		return sent;
 	}
 };
 
@@ -75,6 +200,62 @@ enum MIDIMODE {
 
 
 struct MidiCatParam : ScaledMapParam<int> {
+	/** Frame of the previous ramped MIDI message */
+	int64_t rampFrame = -1;
+	int64_t rampStart = 0;
+	int64_t rampLength = 0;
+	float rampFrom = 0.f;
+	float rampTo = 0.f;
+
+	void reset(bool resetSettings = true) {
+		ScaledMapParam<int>::reset(resetSettings);
+		rampFrame = -1;
+		rampLength = 0;
+	}
+
+	void setValue(int i) {
+		rampLength = 0;
+		ScaledMapParam<int>::setValue(i);
+	}
+
+	/**
+	 * Sets a new value received by a MIDI message at the given frame. The value is reached
+	 * by a linear ramp over the interval since the previous message, so a controller
+	 * sending at a high rate results in a smooth movement. Messages further apart than
+	 * maxLength frames are applied immediately.
+	 */
+	void setValueRamp(int i, int64_t frame, int64_t maxLength) {
+		float from = value;
+		ScaledMapParam<int>::setValue(i);
+		int64_t length = frame - rampFrame;
+		rampFrame = frame;
+		if (from < 0.f || length <= 0 || length > maxLength) {
+			rampLength = 0;
+			return;
+		}
+		rampFrom = from;
+		rampTo = value;
+		rampStart = frame;
+		rampLength = length;
+		value = from;
+	}
+
+	void processRamp(int64_t frame) {
+		if (rampLength == 0) return;
+		float p = float(frame - rampStart) / float(rampLength);
+		if (p >= 1.f) {
+			value = rampTo;
+			rampLength = 0;
+		}
+		else {
+			value = rampFrom + (rampTo - rampFrom) * std::max(p, 0.f);
+		}
+	}
+
+	bool isRamping() {
+		return rampLength > 0;
+	}
+
 	bool isNear(int value, int jump = -1) {
 		if (value == -1) return false;
 		int p = getValue();
@@ -112,18 +293,35 @@ struct MidiCatModule : Module, StripIdFixModule {
 		CCMODE ccMode;
 		/** [Stored to Json] */
 		bool cc14bit = false;
+		/** [Stored to Json] NRPN parameter number, used instead of cc if set */
+		int nrpn = -1;
+		int nrpnValue = -1;
+		uint32_t nrpnTs = 0;
+		int64_t nrpnFrame = 0;
+		/** Frame of the MIDI message of the current value */
+		int64_t frame = 0;
 
 		bool process() {
 			int previous = current;
-			if (cc14bit) {
-				if (module->valuesCcTs[cc] > lastTs && module->valuesCcTs[cc + 32] > lastTs) {
+			if (nrpn >= 0) {
+				if (nrpnTs > lastTs) {
+					current = nrpnValue;
+					frame = nrpnFrame;
+					lastTs = module->ts;
+				}
+			}
+			else if (cc14bit) {
+				// The value is complete on the LSB, the MSB is not sent again if it has not changed
+				if (module->valuesCcTs[cc + 32] > lastTs && module->valuesCc[cc] >= 0) {
 					current = module->valuesCc[cc] * 128 + module->valuesCc[cc + 32];
+					frame = module->valuesCcFrame[cc + 32];
 					lastTs = module->ts;
 				}
 			}
 			else {
 				if (module->valuesCcTs[cc] > lastTs) {
 					current = module->valuesCc[cc];
+					frame = module->valuesCcFrame[cc];
 					lastTs = module->ts;
 				}
 			}
@@ -148,11 +346,10 @@ struct MidiCatModule : Module, StripIdFixModule {
 
 		void reset() {
 			cc = -1;
+			nrpn = -1;
+			nrpnValue = -1;
 			current = -1;
-		}
-
-		void resetValue() {
-			current = -1;
+			module->slotIndexDirty = true;
 		}
 
 		int getCc() {
@@ -161,8 +358,23 @@ struct MidiCatModule : Module, StripIdFixModule {
 
 		void setCc(int cc) {
 			this->cc = cc;
-			if (cc == -1 || cc > 32) set14bit(false);
+			nrpn = -1;
+			set14bit(cc14bit && cc >= 0 && cc <= 32);
 			current = -1;
+			module->slotIndexDirty = true;
+		}
+
+		int getNrpn() {
+			return nrpn;
+		}
+
+		void setNrpn(int nrpn) {
+			this->cc = -1;
+			this->nrpn = nrpn;
+			nrpnValue = -1;
+			set14bit(false);
+			current = -1;
+			module->slotIndexDirty = true;
 		}
 
 		bool get14bit() {
@@ -172,7 +384,8 @@ struct MidiCatModule : Module, StripIdFixModule {
 		void set14bit(bool value) {
 			cc14bit = value;
 			current = -1;
-			if (cc14bit) {
+			module->slotIndexDirty = true;
+			if (cc14bit || nrpn >= 0) {
 				module->midiParam[id].setLimits(0, 128 * 128 - 1, -1);
 			}
 			else {
@@ -214,10 +427,7 @@ struct MidiCatModule : Module, StripIdFixModule {
 		void reset() {
 			note = -1;
 			current = -1;
-		}
-
-		void resetValue() {
-			current = -1;
+			module->slotIndexDirty = true;
 		}
 
 		int getNote() {
@@ -227,6 +437,7 @@ struct MidiCatModule : Module, StripIdFixModule {
 		void setNote(int note) {
 			this->note = note;
 			current = -1;
+			module->slotIndexDirty = true;
 		}
 	};
 
@@ -254,6 +465,7 @@ struct MidiCatModule : Module, StripIdFixModule {
 	/** Whether the CC has been set during the learning session */
 	bool learnedCc;
 	int learnedCcLast = -1;
+	int learnedNrpnLast = -1;
 	/** Whether the note has been set during the learning session */
 	bool learnedNote;
 	int learnedNoteLast = -1;
@@ -276,6 +488,15 @@ struct MidiCatModule : Module, StripIdFixModule {
 	/** The value of each CC number */
 	int valuesCc[128];
 	uint32_t valuesCcTs[128];
+	int64_t valuesCcFrame[128];
+	/** State of the NRPN decoder */
+	int nrpnParamMsb;
+	int nrpnParamLsb;
+	int nrpnDataMsb;
+	/** NRPN parameter numbers which have been sent with data entry LSB */
+	std::bitset<16384> nrpnDataLsb;
+	/** CC number of the previous CC message */
+	int nrpnCcLast;
 	/** The value of each note number */
 	int valuesNote[128];
 	uint32_t valuesNoteTs[128];
@@ -300,10 +521,29 @@ struct MidiCatModule : Module, StripIdFixModule {
 	dsp::ClockDivider processDivider;
 	/** [Stored to Json] */
 	int processDivision;
+
+	/** Slots mapped to each CC number, the LSB of 14-bit CCs included */
+	std::bitset<MAX_CHANNELS> slotsCc[128];
+	/** Slots mapped to each note number */
+	std::bitset<MAX_CHANNELS> slotsNote[128];
+	/** Slots mapped to NRPNs as pairs of NRPN and slot, sorted by NRPN */
+	std::pair<int, int> slotsNrpn[MAX_CHANNELS];
+	int slotsNrpnLen = 0;
+	bool slotIndexDirty = true;
+	/** Slots to be stepped on the current sample */
+	std::bitset<MAX_CHANNELS> slotPending;
+	/** Slots with an active slew limiter */
+	std::bitset<MAX_CHANNELS> slotSlewing;
+	/** Next slot to be checked for manual parameter changes */
+	int slotScan = 0;
+	/** Slots with an active ramp of high resolution input */
+	std::bitset<MAX_CHANNELS> slotRamping;
+	/** Frame of the last step of each slot */
+	int64_t slotFrame[MAX_CHANNELS] = {};
 	dsp::ClockDivider indicatorDivider;
 
 	// Pointer of the MEM-expander's attribute
-	std::map<std::pair<std::string, std::string>, MemModule*>* expMemStorage = NULL;
+	MemStorage* expMemStorage = NULL;
 	Module* expMem = NULL;
 	int64_t expMemModuleId = -1;
 
@@ -343,9 +583,15 @@ struct MidiCatModule : Module, StripIdFixModule {
 		for (int i = 0; i < 128; i++) {
 			valuesCc[i] = -1;
 			valuesCcTs[i] = 0;
+			valuesCcFrame[i] = 0;
 			valuesNote[i] = -1;
 			valuesNoteTs[i] = 0;
 		}
+		nrpnParamMsb = -1;
+		nrpnParamLsb = -1;
+		nrpnDataMsb = -1;
+		nrpnDataLsb.reset();
+		nrpnCcLast = -1;
 		for (int i = 0; i < MAX_CHANNELS; i++) {
 			lastValueIn[i] = -1;
 			lastValueOut[i] = -1;
@@ -358,6 +604,7 @@ struct MidiCatModule : Module, StripIdFixModule {
 		locked = false;
 		midiInput.reset();
 		midiOutput.reset();
+		midiOutput.rateLimit = 0;
 		midiOutput.midi::Output::reset();
 		midiIgnoreDevices = false;
 		midiResendPeriodically = false;
@@ -375,205 +622,35 @@ struct MidiCatModule : Module, StripIdFixModule {
 
 	void process(const ProcessArgs &args) override {
 		ts++;
+		if (slotIndexDirty) slotIndexRebuild();
 
 		midi::Message msg;
-		bool midiReceived = false;
 		while (midiInput.tryPop(&msg, args.frame)) {
-			bool r = midiProcessMessage(msg);
-			midiReceived = midiReceived || r;
+			midiProcessMessage(msg);
+		}
+
+		// Only step slots mapped to a received MIDI message. Additionally step a few slots
+		// every processDivision samples for manual parameter changes and all slots which
+		// are currently slewing. Notice that midi allows about 1000 messages per second,
+		// so checking for changes more often won't lead to higher precision on midi output.
+		if (processDivider.process()) {
+			for (int i = 0; i < std::min(SCAN_SLOTS, mapLen); i++) {
+				if (slotScan >= mapLen) slotScan = 0;
+				slotPending[slotScan] = true;
+				slotScan++;
+			}
+			slotPending |= slotSlewing;
 		}
-
-		// Only step channels when some midi event has been received. Additionally
-		// step channels for parameter changes made manually every 128th loop. Notice
-		// that midi allows about 1000 messages per second, so checking for changes more often
-		// won't lead to higher precision on midi output.
-		if (processDivider.process() || midiReceived) {
-			// Step channels
+		// Slots ramping to a high resolution value are stepped on every sample
+		slotPending |= slotRamping;
+		if (slotPending.any()) {
 			for (int id = 0; id < mapLen; id++) {
-				int cc = ccs[id].getCc();
-				int note = notes[id].getNote();
-				if (cc < 0 && note < 0)
-					continue;
-
-				// Get Module
-				Module* module = paramHandles[id].module;
-				if (!module)
-					continue;
-
-				// Get ParamQuantity
-				int paramId = paramHandles[id].paramId;
-				ParamQuantity* paramQuantity = module->paramQuantities[paramId];
-				if (!paramQuantity)
-					continue;
-
-				if (!paramQuantity->isBounded())
-					continue;
-
-				switch (midiMode) {
-					case MIDIMODE::MIDIMODE_DEFAULT: {
-						midiParam[id].paramQuantity = paramQuantity;
-						int t = -1;
-
-						// Check if CC value has been set and changed
-						if (cc >= 0 && ccs[id].process()) {
-							switch (ccs[id].ccMode) {
-								case CCMODE::DIRECT:
-									if (lastValueIn[id] != ccs[id].getValue()) {
-										lastValueIn[id] = ccs[id].getValue();
-										t = ccs[id].getValue();
-									}
-									break;
-								case CCMODE::PICKUP1:
-									if (lastValueIn[id] != ccs[id].getValue()) {
-										if (midiParam[id].isNear(lastValueIn[id])) {
-											midiParam[id].resetFilter();
-											t = ccs[id].getValue();
-										}
-										lastValueIn[id] = ccs[id].getValue();
-									}
-									break;
-								case CCMODE::PICKUP2:
-									if (lastValueIn[id] != ccs[id].getValue()) {
-										if (midiParam[id].isNear(lastValueIn[id], ccs[id].getValue())) {
-											midiParam[id].resetFilter();
-											t = ccs[id].getValue();
-										}
-										lastValueIn[id] = ccs[id].getValue();
-									}
-									break;
-								case CCMODE::TOGGLE:
-									if (ccs[id].getValue() > 0 && (lastValueIn[id] == -1 || lastValueIn[id] >= 0)) {
-										t = midiParam[id].getLimitMax();
-										lastValueIn[id] = -2;
-									} 
-									else if (ccs[id].getValue() == 0 && lastValueIn[id] == -2) {
-										t = midiParam[id].getLimitMax();
-										lastValueIn[id] = -3;
-									}
-									else if (ccs[id].getValue() > 0 && lastValueIn[id] == -3) {
-										t = midiParam[id].getLimitMin();
-										lastValueIn[id] = -4;
-									}
-									else if (ccs[id].getValue() == 0 && lastValueIn[id] == -4) {
-										t = midiParam[id].getLimitMin();
-										lastValueIn[id] = -1;
-									}
-									break;
-								case CCMODE::TOGGLE_VALUE:
-									if (ccs[id].getValue() > 0 && (lastValueIn[id] == -1 || lastValueIn[id] >= 0)) {
-										t = ccs[id].getValue();
-										lastValueIn[id] = -2;
-									} 
-									else if (ccs[id].getValue() == 0 && lastValueIn[id] == -2) {
-										t = midiParam[id].getValue();
-										lastValueIn[id] = -3;
-									}
-									else if (ccs[id].getValue() > 0 && lastValueIn[id] == -3) {
-										t = midiParam[id].getLimitMin();
-										lastValueIn[id] = -4;
-									}
-									else if (ccs[id].getValue() == 0 && lastValueIn[id] == -4) {
-										t = midiParam[id].getLimitMin();
-										lastValueIn[id] = -1;
-									}
-									break;
-							}
-						}
-
-						// Check if note value has been set and changed
-						if (note >= 0 && notes[id].process()) {
-							switch (notes[id].noteMode) {
-								case NOTEMODE::MOMENTARY:
-									if (lastValueIn[id] != notes[id].getValue()) {
-										t = notes[id].getValue();
-										if (t > 0) t = 127;
-										lastValueIn[id] = notes[id].getValue();
-									} 
-									break;
-								case NOTEMODE::MOMENTARY_VEL:
-									if (lastValueIn[id] != notes[id].getValue()) {
-										t = notes[id].getValue();
-										lastValueIn[id] = notes[id].getValue();
-									}
-									break;
-								case NOTEMODE::TOGGLE:
-									if (notes[id].getValue() > 0 && (lastValueIn[id] == -1 || lastValueIn[id] >= 0)) {
-										t = 127;
-										lastValueIn[id] = -2;
-									} 
-									else if (notes[id].getValue() == 0 && lastValueIn[id] == -2) {
-										t = 127;
-										lastValueIn[id] = -3;
-									}
-									else if (notes[id].getValue() > 0 && lastValueIn[id] == -3) {
-										t = 0;
-										lastValueIn[id] = -4;
-									}
-									else if (notes[id].getValue() == 0 && lastValueIn[id] == -4) {
-										t = 0;
-										lastValueIn[id] = -1;
-									}
-									break;
-								case NOTEMODE::TOGGLE_VEL:
-									if (notes[id].getValue() > 0 && (lastValueIn[id] == -1 || lastValueIn[id] >= 0)) {
-										t = notes[id].getValue();
-										lastValueIn[id] = -2;
-									} 
-									else if (notes[id].getValue() == 0 && lastValueIn[id] == -2) {
-										t = midiParam[id].getValue();
-										lastValueIn[id] = -3;
-									}
-									else if (notes[id].getValue() > 0 && lastValueIn[id] == -3) {
-										t = 0;
-										lastValueIn[id] = -4;
-									}
-									else if (notes[id].getValue() == 0 && lastValueIn[id] == -4) {
-										t = 0;
-										lastValueIn[id] = -1;
-									}
-									break;
-							}
-						}
-
-						// Set a new value for the mapped parameter
-						if (t >= 0) {
-							midiParam[id].setValue(t);
-							if (overlayEnabled && overlayQueue.capacity() > 0) overlayQueue.push(id);
-						}
-
-						// Apply value on the mapped parameter (respecting slew and scale)
-						midiParam[id].process(args.sampleTime * float(processDivision));
-
-						// Retrieve the current value of the parameter (ignoring slew and scale)
-						int v = midiParam[id].getValue();
-
-						// Midi feedback
-						if (lastValueOut[id] != v) {
-							if (cc >= 0 && ccs[id].ccMode == CCMODE::DIRECT)
-								lastValueIn[id] = v;
-							ccs[id].setValue(v, lastValueIn[id] < 0);
-							notes[id].setValue(v, lastValueIn[id] < 0);
-							lastValueOut[id] = v;
-						}
-					} break;
-
-					case MIDIMODE::MIDIMODE_LOCATE: {
-						bool indicate = false;
-						if ((cc >= 0 && ccs[id].getValue() >= 0) && lastValueInIndicate[id] != ccs[id].getValue()) {
-							lastValueInIndicate[id] = ccs[id].getValue();
-							indicate = true;
-						}
-						if ((note >= 0 && notes[id].getValue() >= 0) && lastValueInIndicate[id] != notes[id].getValue()) {
-							lastValueInIndicate[id] = notes[id].getValue();
-							indicate = true;
-						}
-						if (indicate) {
-							ModuleWidget* mw = APP->scene->rack->getModule(paramQuantity->module->id);
-							paramHandleIndicator[id].indicate(mw);
-						}
-					} break;
-				}
+				if (!slotPending[id]) continue;
+				processSlot(id, args);
+				slotSlewing[id] = midiParam[id].isSlewing();
+				slotRamping[id] = midiParam[id].isRamping();
 			}
+			slotPending.reset();
 		}
 
 		if (indicatorDivider.process()) {
@@ -589,6 +666,7 @@ struct MidiCatModule : Module, StripIdFixModule {
 		if (midiResendPeriodically && midiResendDivider.process()) {
 			midiResendFeedback();
 		}
+		midiOutput.process(args.sampleTime);
 
 		// Expanders
 		bool expMemFound = false;
@@ -597,7 +675,7 @@ struct MidiCatModule : Module, StripIdFixModule {
 		for (int i = 0; i < 2; i++) {
 			if (!exp) break;
 			if (exp->model == modelMidiCatMem && !expMemFound) {
-				expMemStorage = reinterpret_cast<std::map<std::pair<std::string, std::string>, MemModule*>*>(exp->leftExpander.consumerMessage);
+				expMemStorage = reinterpret_cast<MemStorage*>(exp->leftExpander.consumerMessage);
 				expMem = exp;
 				expMemFound = true;
 				exp = exp->rightExpander.module;
@@ -620,6 +698,204 @@ struct MidiCatModule : Module, StripIdFixModule {
 		}
 	}
 
+	/**
+	 * Steps a single slot: applies received MIDI values on the mapped parameter and
+	 * sends MIDI feedback for changes of the parameter.
+	 */
+	void processSlot(int id, const ProcessArgs& args) {
+		int cc = ccs[id].getCc();
+		int nrpn = ccs[id].getNrpn();
+		int note = notes[id].getNote();
+		if (cc < 0 && nrpn < 0 && note < 0)
+			return;
+
+		// Get Module
+		Module* module = paramHandles[id].module;
+		if (!module)
+			return;
+
+		// Get ParamQuantity
+		int paramId = paramHandles[id].paramId;
+		ParamQuantity* paramQuantity = module->paramQuantities[paramId];
+		if (!paramQuantity)
+			return;
+
+		if (!paramQuantity->isBounded())
+			return;
+
+		switch (midiMode) {
+			case MIDIMODE::MIDIMODE_DEFAULT: {
+				midiParam[id].paramQuantity = paramQuantity;
+				int t = -1;
+				bool ramp = false;
+
+				// Check if CC value has been set and changed
+				if ((cc >= 0 || nrpn >= 0) && ccs[id].process()) {
+					// High resolution input is ramped between messages in the continuous modes
+					ramp = (nrpn >= 0 || ccs[id].get14bit()) && (ccs[id].ccMode == CCMODE::DIRECT || ccs[id].ccMode == CCMODE::PICKUP1 || ccs[id].ccMode == CCMODE::PICKUP2);
+					switch (ccs[id].ccMode) {
+						case CCMODE::DIRECT:
+							if (lastValueIn[id] != ccs[id].getValue()) {
+								lastValueIn[id] = ccs[id].getValue();
+								t = ccs[id].getValue();
+							}
+							break;
+						case CCMODE::PICKUP1:
+							if (lastValueIn[id] != ccs[id].getValue()) {
+								if (midiParam[id].isNear(lastValueIn[id])) {
+									midiParam[id].resetFilter();
+									t = ccs[id].getValue();
+								}
+								lastValueIn[id] = ccs[id].getValue();
+							}
+							break;
+						case CCMODE::PICKUP2:
+							if (lastValueIn[id] != ccs[id].getValue()) {
+								if (midiParam[id].isNear(lastValueIn[id], ccs[id].getValue())) {
+									midiParam[id].resetFilter();
+									t = ccs[id].getValue();
+								}
+								lastValueIn[id] = ccs[id].getValue();
+							}
+							break;
+						case CCMODE::TOGGLE:
+							if (ccs[id].getValue() > 0 && (lastValueIn[id] == -1 || lastValueIn[id] >= 0)) {
+								t = midiParam[id].getLimitMax();
+								lastValueIn[id] = -2;
+							} 
+							else if (ccs[id].getValue() == 0 && lastValueIn[id] == -2) {
+								t = midiParam[id].getLimitMax();
+								lastValueIn[id] = -3;
+							}
+							else if (ccs[id].getValue() > 0 && lastValueIn[id] == -3) {
+								t = midiParam[id].getLimitMin();
+								lastValueIn[id] = -4;
+							}
+							else if (ccs[id].getValue() == 0 && lastValueIn[id] == -4) {
+								t = midiParam[id].getLimitMin();
+								lastValueIn[id] = -1;
+							}
+							break;
+						case CCMODE::TOGGLE_VALUE:
+							if (ccs[id].getValue() > 0 && (lastValueIn[id] == -1 || lastValueIn[id] >= 0)) {
+								t = ccs[id].getValue();
+								lastValueIn[id] = -2;
+							} 
+							else if (ccs[id].getValue() == 0 && lastValueIn[id] == -2) {
+								t = midiParam[id].getValue();
+								lastValueIn[id] = -3;
+							}
+							else if (ccs[id].getValue() > 0 && lastValueIn[id] == -3) {
+								t = midiParam[id].getLimitMin();
+								lastValueIn[id] = -4;
+							}
+							else if (ccs[id].getValue() == 0 && lastValueIn[id] == -4) {
+								t = midiParam[id].getLimitMin();
+								lastValueIn[id] = -1;
+							}
+							break;
+					}
+				}
+
+				// Check if note value has been set and changed
+				if (note >= 0 && notes[id].process()) {
+					switch (notes[id].noteMode) {
+						case NOTEMODE::MOMENTARY:
+							if (lastValueIn[id] != notes[id].getValue()) {
+								t = notes[id].getValue();
+								if (t > 0) t = 127;
+								lastValueIn[id] = notes[id].getValue();
+							} 
+							break;
+						case NOTEMODE::MOMENTARY_VEL:
+							if (lastValueIn[id] != notes[id].getValue()) {
+								t = notes[id].getValue();
+								lastValueIn[id] = notes[id].getValue();
+							}
+							break;
+						case NOTEMODE::TOGGLE:
+							if (notes[id].getValue() > 0 && (lastValueIn[id] == -1 || lastValueIn[id] >= 0)) {
+								t = 127;
+								lastValueIn[id] = -2;
+							} 
+							else if (notes[id].getValue() == 0 && lastValueIn[id] == -2) {
+								t = 127;
+								lastValueIn[id] = -3;
+							}
+							else if (notes[id].getValue() > 0 && lastValueIn[id] == -3) {
+								t = 0;
+								lastValueIn[id] = -4;
+							}
+							else if (notes[id].getValue() == 0 && lastValueIn[id] == -4) {
+								t = 0;
+								lastValueIn[id] = -1;
+							}
+							break;
+						case NOTEMODE::TOGGLE_VEL:
+							if (notes[id].getValue() > 0 && (lastValueIn[id] == -1 || lastValueIn[id] >= 0)) {
+								t = notes[id].getValue();
+								lastValueIn[id] = -2;
+							} 
+							else if (notes[id].getValue() == 0 && lastValueIn[id] == -2) {
+								t = midiParam[id].getValue();
+								lastValueIn[id] = -3;
+							}
+							else if (notes[id].getValue() > 0 && lastValueIn[id] == -3) {
+								t = 0;
+								lastValueIn[id] = -4;
+							}
+							else if (notes[id].getValue() == 0 && lastValueIn[id] == -4) {
+								t = 0;
+								lastValueIn[id] = -1;
+							}
+							break;
+					}
+				}
+
+				// Set a new value for the mapped parameter
+				if (t >= 0) {
+					if (ramp) midiParam[id].setValueRamp(t, ccs[id].frame, int64_t(RAMP_MAX * args.sampleRate));
+					else midiParam[id].setValue(t);
+					if (overlayEnabled && overlayQueue.capacity() > 0) overlayQueue.push(id);
+				}
+
+				// Apply value on the mapped parameter (respecting slew and scale)
+				int64_t frames = std::min(std::max(args.frame - slotFrame[id], int64_t(1)), int64_t(processDivision));
+				slotFrame[id] = args.frame;
+				midiParam[id].processRamp(args.frame);
+				midiParam[id].process(args.sampleTime * float(frames));
+
+				// Retrieve the current value of the parameter (ignoring slew and scale)
+				int v = midiParam[id].getValue();
+
+				// Midi feedback
+				if (lastValueOut[id] != v) {
+					if ((cc >= 0 || nrpn >= 0) && ccs[id].ccMode == CCMODE::DIRECT)
+						lastValueIn[id] = v;
+					ccs[id].setValue(v, lastValueIn[id] < 0);
+					notes[id].setValue(v, lastValueIn[id] < 0);
+					lastValueOut[id] = v;
+				}
+			} break;
+
+			case MIDIMODE::MIDIMODE_LOCATE: {
+				bool indicate = false;
+				if ((cc >= 0 && ccs[id].getValue() >= 0) && lastValueInIndicate[id] != ccs[id].getValue()) {
+					lastValueInIndicate[id] = ccs[id].getValue();
+					indicate = true;
+				}
+				if ((note >= 0 && notes[id].getValue() >= 0) && lastValueInIndicate[id] != notes[id].getValue()) {
+					lastValueInIndicate[id] = notes[id].getValue();
+					indicate = true;
+				}
+				if (indicate) {
+					ModuleWidget* mw = APP->scene->rack->getModule(paramQuantity->module->id);
+					paramHandleIndicator[id].indicate(mw);
+				}
+			} break;
+		}
+	}
+
 	void setMode(MIDIMODE midiMode) {
 		if (this->midiMode == midiMode)
 			return;
@@ -663,8 +939,9 @@ struct MidiCatModule : Module, StripIdFixModule {
 	bool midiCc(midi::Message msg) {
 		uint8_t cc = msg.getNote();
 		uint8_t value = msg.getValue();
+		bool nrpn = midiNrpn(cc, value, msg.frame);
 		// Learn
-		if (learningId >= 0 && learnedCcLast != cc && learnedCcLast != cc - 32 && valuesCc[cc] != value) {
+		if (learningId >= 0 && !nrpn && learnedCcLast != cc && learnedCcLast != cc - 32 && valuesCc[cc] != value) {
 			ccs[learningId].setCc(cc);
 			ccs[learningId].ccMode = CCMODE::DIRECT;
 			notes[learningId].setNote(-1);
@@ -677,9 +954,97 @@ struct MidiCatModule : Module, StripIdFixModule {
 		bool midiReceived = valuesCc[cc] != value;
 		valuesCc[cc] = value;
 		valuesCcTs[cc] = ts;
+		valuesCcFrame[cc] = msg.frame;
+		// An unchanged LSB can still complete a 14-bit value whose MSB has changed
+		slotPendingAdd(slotsCc[cc]);
 		return midiReceived;
 	}
 
+	/**
+	 * Decodes NRPN messages, returns true if the CC is part of an NRPN or RPN sequence
+	 * and must not be learned as plain CC.
+	 * A parameter number CC received twice in a row is sent by a plain CC control as
+	 * NRPN sequences never repeat it, data entry is plain CC unless an NRPN is selected.
+	 */
+	bool midiNrpn(uint8_t cc, uint8_t value, int64_t frame) {
+		bool repeated = nrpnCcLast == cc;
+		nrpnCcLast = cc;
+		switch (cc) {
+			// NRPN parameter number
+			case 99: {
+				if (repeated) {
+					nrpnParamMsb = -1;
+					nrpnDataMsb = -1;
+					return false;
+				}
+				if (nrpnParamMsb != value) nrpnDataMsb = -1;
+				nrpnParamMsb = value;
+				return true;
+			}
+			case 98: {
+				if (repeated) {
+					nrpnParamLsb = -1;
+					nrpnDataMsb = -1;
+					return false;
+				}
+				if (nrpnParamLsb != value) nrpnDataMsb = -1;
+				nrpnParamLsb = value;
+				return true;
+			}
+			// RPN parameter number, RPNs are not supported
+			case 101:
+			case 100: {
+				nrpnParamMsb = -1;
+				nrpnParamLsb = -1;
+				nrpnDataMsb = -1;
+				return !repeated;
+			}
+			// Data entry MSB
+			case 6: {
+				if (nrpnParamMsb < 0 || nrpnParamLsb < 0) return false;
+				nrpnDataMsb = value;
+				// Parameters sent with LSB complete the value on the LSB only
+				int nrpn = nrpnParamMsb * 128 + nrpnParamLsb;
+				if (!nrpnDataLsb[nrpn]) midiNrpnValue(nrpn, value * 128, frame);
+				return true;
+			}
+			// Data entry LSB
+			case 38: {
+				if (nrpnParamMsb < 0 || nrpnParamLsb < 0 || nrpnDataMsb < 0) return false;
+				int nrpn = nrpnParamMsb * 128 + nrpnParamLsb;
+				nrpnDataLsb[nrpn] = true;
+				midiNrpnValue(nrpn, nrpnDataMsb * 128 + value, frame);
+				return true;
+			}
+			default: {
+				return false;
+			}
+		}
+	}
+
+	void midiNrpnValue(int nrpn, int value, int64_t frame) {
+		// Learn
+		if (learningId >= 0 && learnedNrpnLast != nrpn) {
+			ccs[learningId].setNrpn(nrpn);
+			ccs[learningId].ccMode = CCMODE::DIRECT;
+			notes[learningId].setNote(-1);
+			learnedCc = true;
+			learnedNrpnLast = nrpn;
+			commitLearn();
+			updateMapLen();
+			refreshParamHandleText(learningId);
+		}
+		if (slotIndexDirty) slotIndexRebuild();
+		auto it = std::lower_bound(slotsNrpn, slotsNrpn + slotsNrpnLen, std::make_pair(nrpn, -1));
+		for (; it != slotsNrpn + slotsNrpnLen && it->first == nrpn; it++) {
+			int id = it->second;
+			ccs[id].nrpnValue = value;
+			ccs[id].nrpnTs = ts;
+			ccs[id].nrpnFrame = frame;
+			slotPending[id] = true;
+		}
+	}
+
 	bool midiNotePress(midi::Message msg) {
 		uint8_t note = msg.getNote();
 		uint8_t vel = msg.getValue();
@@ -697,6 +1062,7 @@ struct MidiCatModule : Module, StripIdFixModule {
 		bool midiReceived = valuesNote[note] != vel;
 		valuesNote[note] = vel;
 		valuesNoteTs[note] = ts;
+		if (midiReceived) slotPendingAdd(slotsNote[note]);
 		return midiReceived;
 	}
 
@@ -705,15 +1071,48 @@ struct MidiCatModule : Module, StripIdFixModule {
 		bool midiReceived = valuesNote[note] != 0;
 		valuesNote[note] = 0;
 		valuesNoteTs[note] = ts;
+		if (midiReceived) slotPendingAdd(slotsNote[note]);
 		return midiReceived;
 	}
 
 	void midiResendFeedback() {
-		for (int i = 0; i < MAX_CHANNELS; i++) {
-			lastValueOut[i] = -1;
-			ccs[i].resetValue();
-			notes[i].resetValue();
+		midiOutput.resendFeedback();
+	}
+
+	/** Marks slots as pending, the slot index is rebuilt first if mappings have changed */
+	void slotPendingAdd(const std::bitset<MAX_CHANNELS>& slots) {
+		if (slotIndexDirty) slotIndexRebuild();
+		slotPending |= slots;
+	}
+
+	/** Rebuilds the index of slots for each CC, NRPN and note number, called on the engine thread */
+	void slotIndexRebuild() {
+		slotIndexDirty = false;
+		for (int i = 0; i < 128; i++) {
+			slotsCc[i].reset();
+			slotsNote[i].reset();
 		}
+		slotsNrpnLen = 0;
+		for (int id = 0; id < mapLen; id++) {
+			int nrpn = ccs[id].getNrpn();
+			if (nrpn >= 0) {
+				slotsNrpn[slotsNrpnLen++] = std::make_pair(nrpn, id);
+			}
+			int cc = ccs[id].getCc();
+			if (cc >= 0) {
+				slotsCc[cc][id] = true;
+				if (ccs[id].get14bit()) slotsCc[cc + 32][id] = true;
+			}
+			int note = notes[id].getNote();
+			if (note >= 0) {
+				slotsNote[note][id] = true;
+			}
+		}
+		std::sort(slotsNrpn, slotsNrpn + slotsNrpnLen);
+		// Mappings have changed, step all slots once
+		slotPending.set();
+		slotSlewing.reset();
+		slotRamping.reset();
 	}
 
 	void clearMap(int id, bool midiOnly = false) {
@@ -764,7 +1163,7 @@ struct MidiCatModule : Module, StripIdFixModule {
 		// Find last nonempty map
 		int id;
 		for (id = MAX_CHANNELS - 1; id >= 0; id--) {
-			if (ccs[id].getCc() >= 0 || notes[id].getNote() >= 0 || paramHandles[id].moduleId >= 0)
+			if (ccs[id].getCc() >= 0 || ccs[id].getNrpn() >= 0 || notes[id].getNote() >= 0 || paramHandles[id].moduleId >= 0)
 				break;
 		}
 		mapLen = id + 1;
@@ -772,6 +1171,7 @@ struct MidiCatModule : Module, StripIdFixModule {
 		if (mapLen < MAX_CHANNELS) {
 			mapLen++;
 		}
+		slotIndexDirty = true;
 	}
 
 	void commitLearn() {
@@ -799,7 +1199,7 @@ struct MidiCatModule : Module, StripIdFixModule {
 
 		// Find next incomplete map
 		while (!learnSingleSlot && ++learningId < MAX_CHANNELS) {
-			if ((ccs[learningId].getCc() < 0 && notes[learningId].getNote() < 0) || paramHandles[learningId].moduleId < 0)
+			if ((ccs[learningId].getCc() < 0 && ccs[learningId].getNrpn() < 0 && notes[learningId].getNote() < 0) || paramHandles[learningId].moduleId < 0)
 				return;
 		}
 		learningId = -1;
@@ -809,7 +1209,7 @@ struct MidiCatModule : Module, StripIdFixModule {
 		if (id == -1) {
 			// Find next incomplete map
 			while (++id < MAX_CHANNELS) {
-				if (ccs[id].getCc() < 0 && notes[id].getNote() < 0 && paramHandles[id].moduleId < 0)
+				if (ccs[id].getCc() < 0 && ccs[id].getNrpn() < 0 && notes[id].getNote() < 0 && paramHandles[id].moduleId < 0)
 					break;
 			}
 			if (id == MAX_CHANNELS) {
@@ -825,6 +1225,7 @@ struct MidiCatModule : Module, StripIdFixModule {
 			learningId = id;
 			learnedCc = false;
 			learnedCcLast = -1;
+			learnedNrpnLast = -1;
 			learnedNote = false;
 			learnedNoteLast = -1;
 			learnedParam = false;
@@ -882,6 +1283,9 @@ struct MidiCatModule : Module, StripIdFixModule {
 		if (ccs[id].getCc() >= 0) {
 			text += string::f(" cc%02d", ccs[id].getCc());
 		}
+		if (ccs[id].getNrpn() >= 0) {
+			text += string::f(" nrpn%d", ccs[id].getNrpn());
+		}
 		if (notes[id].getNote() >= 0) {
 			static const char* noteNames[] = {
 				"C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B"
@@ -894,11 +1298,14 @@ struct MidiCatModule : Module, StripIdFixModule {
 	}
 
 	void expMemSave(std::string pluginSlug, std::string moduleSlug) {
+		uint64_t key = memKey(pluginSlug, moduleSlug);
 		MemModule* m = new MemModule;
+		m->pluginSlug = pluginSlug;
+		m->moduleSlug = moduleSlug;
 		Module* module = NULL;
 		for (size_t i = 0; i < MAX_CHANNELS; i++) {
 			if (paramHandles[i].moduleId < 0) continue;
-			if (paramHandles[i].module->model->plugin->slug != pluginSlug && paramHandles[i].module->model->slug == moduleSlug) continue;
+			if (memKey(paramHandles[i].module->model) != key) continue;
 			module = paramHandles[i].module;
 
 			MemParam* p = new MemParam;
@@ -906,6 +1313,7 @@ struct MidiCatModule : Module, StripIdFixModule {
 			p->cc = ccs[i].getCc();
 			p->ccMode = ccs[i].ccMode;
 			p->cc14bit = ccs[i].get14bit();
+			p->nrpn = ccs[i].getNrpn();
 			p->note = notes[i].getNote();
 			p->noteMode = notes[i].noteMode;
 			p->label = textLabel[i];
@@ -918,28 +1326,25 @@ struct MidiCatModule : Module, StripIdFixModule {
 		m->pluginName = module->model->plugin->name;
 		m->moduleName = module->model->name;
 
-		auto p = std::pair<std::string, std::string>(pluginSlug, moduleSlug);
-		auto it = expMemStorage->find(p);
+		auto it = expMemStorage->find(key);
 		if (it != expMemStorage->end()) {
 			delete it->second;
 		}
 
-		(*expMemStorage)[p] = m;
+		(*expMemStorage)[key] = m;
 	}
 
 	void expMemDelete(std::string pluginSlug, std::string moduleSlug) {
-		auto p = std::pair<std::string, std::string>(pluginSlug, moduleSlug);
-		auto it = expMemStorage->find(p);
+		auto it = expMemStorage->find(memKey(pluginSlug, moduleSlug));
+		if (it == expMemStorage->end()) return;
 		delete it->second;
-		expMemStorage->erase(p);
+		expMemStorage->erase(it);
 	}
 
 	void expMemApply(Module* m) {
 		if (!m) return;
-		auto p = std::pair<std::string, std::string>(m->model->plugin->slug, m->model->slug);
-		auto it = expMemStorage->find(p);
-		if (it == expMemStorage->end()) return;
-		MemModule* map = it->second;
+		MemModule* map = memFind(expMemStorage, m->model);
+		if (!map) return;
 
 		clearMaps_WithLock();
 		expMemModuleId = m->id;
@@ -949,6 +1354,7 @@ struct MidiCatModule : Module, StripIdFixModule {
 			ccs[i].setCc(it->cc);
 			ccs[i].ccMode = it->ccMode;
 			ccs[i].set14bit(it->cc14bit);
+			if (it->nrpn >= 0) ccs[i].setNrpn(it->nrpn);
 			notes[i].setNote(it->note);
 			notes[i].noteMode = it->noteMode;
 			textLabel[i] = it->label;
@@ -963,10 +1369,7 @@ struct MidiCatModule : Module, StripIdFixModule {
 
 	bool expMemTest(Module* m) {
 		if (!m) return false;
-		auto p = std::pair<std::string, std::string>(m->model->plugin->slug, m->model->slug);
-		auto it = expMemStorage->find(p);
-		if (it == expMemStorage->end()) return false;
-		return true;
+		return memFind(expMemStorage, m->model) != NULL;
 	}
 
 	void setProcessDivision(int d) {
@@ -992,6 +1395,7 @@ struct MidiCatModule : Module, StripIdFixModule {
 			json_object_set_new(mapJ, "cc", json_integer(ccs[id].getCc()));
 			json_object_set_new(mapJ, "ccMode", json_integer((int)ccs[id].ccMode));
 			json_object_set_new(mapJ, "cc14bit", json_boolean(ccs[id].get14bit()));
+			json_object_set_new(mapJ, "nrpn", json_integer(ccs[id].getNrpn()));
 			json_object_set_new(mapJ, "note", json_integer(notes[id].getNote()));
 			json_object_set_new(mapJ, "noteMode", json_integer((int)notes[id].noteMode));
 			json_object_set_new(mapJ, "moduleId", json_integer(paramHandles[id].moduleId));
@@ -1006,6 +1410,7 @@ struct MidiCatModule : Module, StripIdFixModule {
 		json_object_set_new(rootJ, "maps", mapsJ);
 
 		json_object_set_new(rootJ, "midiResendPeriodically", json_boolean(midiResendPeriodically));
+		json_object_set_new(rootJ, "midiFeedbackRateLimit", json_integer(midiOutput.rateLimit));
 		json_object_set_new(rootJ, "midiIgnoreDevices", json_boolean(midiIgnoreDevices));
 		json_object_set_new(rootJ, "midiInput", midiInput.toJson());
 		json_object_set_new(rootJ, "midiOutput", midiOutput.toJson());
@@ -1069,6 +1474,8 @@ struct MidiCatModule : Module, StripIdFixModule {
 				ccs[mapIndex].setCc(ccJ ? json_integer_value(ccJ) : -1);
 				ccs[mapIndex].ccMode = (CCMODE)json_integer_value(ccModeJ);
 				if (cc14bitJ) ccs[mapIndex].set14bit(json_boolean_value(cc14bitJ));
+				json_t* nrpnJ = json_object_get(mapJ, "nrpn");
+				if (nrpnJ && json_integer_value(nrpnJ) >= 0) ccs[mapIndex].setNrpn(json_integer_value(nrpnJ));
 				notes[mapIndex].setNote(noteJ ? json_integer_value(noteJ) : -1);
 				notes[mapIndex].noteMode = (NOTEMODE)json_integer_value(noteModeJ);
 				midiOptions[mapIndex] = json_integer_value(midiOptionsJ);
@@ -1093,6 +1500,8 @@ struct MidiCatModule : Module, StripIdFixModule {
 		
 		json_t* midiResendPeriodicallyJ = json_object_get(rootJ, "midiResendPeriodically");
 		if (midiResendPeriodicallyJ) midiResendPeriodically = json_boolean_value(midiResendPeriodicallyJ);
+		json_t* midiFeedbackRateLimitJ = json_object_get(rootJ, "midiFeedbackRateLimit");
+		midiOutput.rateLimit = midiFeedbackRateLimitJ ? json_integer_value(midiFeedbackRateLimitJ) : 0;
 
 		if (!midiIgnoreDevices) {
 			json_t* midiIgnoreDevicesJ = json_object_get(rootJ, "midiIgnoreDevices");
@@ -1277,6 +1686,9 @@ struct MidiCatChoice : MapModuleChoice<MAX_CHANNELS, MidiCatModule> {
 		if (module->ccs[id].getCc() >= 0) {
 			return string::f("cc%02d ", module->ccs[id].getCc());
 		}
+		else if (module->ccs[id].getNrpn() >= 0) {
+			return "nrpn ";
+		}
 		else if (module->notes[id].getNote() >= 0) {
 			static const char* noteNames[] = {
 				" C", "C#", " D", "D#", " E", " F", "F#", " G", "G#", " A", "A#", " B"
@@ -1396,7 +1808,7 @@ struct MidiCatChoice : MapModuleChoice<MAX_CHANNELS, MidiCatModule> {
 			}
 		}; // struct NoteVelZeroMenuItem
 
-		if (module->ccs[id].getCc() >= 0 || module->notes[id].getNote() >= 0) {
+		if (module->ccs[id].getCc() >= 0 || module->ccs[id].getNrpn() >= 0 || module->notes[id].getNote() >= 0) {
 			menu->addChild(construct<UnmapMidiItem>(&MenuItem::text, "Clear MIDI assignment", &UnmapMidiItem::module, module, &UnmapMidiItem::id, id));
 		}
 		if (module->ccs[id].getCc() >= 0) {
@@ -1404,6 +1816,11 @@ struct MidiCatChoice : MapModuleChoice<MAX_CHANNELS, MidiCatModule> {
 			menu->addChild(construct<CcModeMenuItem>(&MenuItem::text, "Input mode for CC", &CcModeMenuItem::module, module, &CcModeMenuItem::id, id));
 			menu->addChild(construct<Cc14bitItem>(&MenuItem::text, "14-bit", &MenuItem::disabled, module->ccs[id].getCc() > 32, &Cc14bitItem::module, module, &Cc14bitItem::id, id));
 		}
+		if (module->ccs[id].getNrpn() >= 0) {
+			menu->addChild(new MenuSeparator());
+			menu->addChild(createMenuLabel(string::f("NRPN %d", module->ccs[id].getNrpn())));
+			menu->addChild(construct<CcModeMenuItem>(&MenuItem::text, "Input mode for NRPN", &CcModeMenuItem::module, module, &CcModeMenuItem::id, id));
+		}
 		if (module->notes[id].getNote() >= 0) {
 			menu->addChild(new MenuSeparator());
 			menu->addChild(construct<NoteModeMenuItem>(&MenuItem::text, "Input mode for notes", &NoteModeMenuItem::module, module, &NoteModeMenuItem::id, id));
@@ -1493,7 +1910,7 @@ struct MidiCatChoice : MapModuleChoice<MAX_CHANNELS, MidiCatModule> {
 
 		menu->addChild(new SlewSlider(&module->midiParam[id]));
 		menu->addChild(construct<MenuLabel>(&MenuLabel::text, "Scaling"));
-		std::string l = string::f("Input %s", module->ccs[id].getCc() >= 0 ? "MIDI CC" : (module->notes[id].getNote() >= 0 ? "MIDI vel" : ""));
+		std::string l = string::f("Input %s", module->ccs[id].getCc() >= 0 ? "MIDI CC" : (module->ccs[id].getNrpn() >= 0 ? "MIDI NRPN" : (module->notes[id].getNote() >= 0 ? "MIDI vel" : "")));
 		menu->addChild(construct<ScalingInputLabel>(&MenuLabel::text, l, &ScalingInputLabel::p, &module->midiParam[id]));
 		menu->addChild(construct<ScalingOutputLabel>(&MenuLabel::text, "Parameter range", &ScalingOutputLabel::p, &module->midiParam[id]));
 		menu->addChild(new MinSlider(&module->midiParam[id]));
@@ -1849,7 +2266,7 @@ struct MidiCatWidget : ThemedModuleWidget<MidiCatModule>, ParamWidgetContextExte
 				if (module->mapLen > 0) {
 					menu->addChild(new MenuSeparator);
 					for (int i = 0; i < module->mapLen; i++) {
-						if (module->ccs[i].getCc() >= 0 || module->notes[i].getNote() >= 0) {
+						if (module->ccs[i].getCc() >= 0 || module->ccs[i].getNrpn() >= 0 || module->notes[i].getNote() >= 0) {
 							std::string text;
 							if (module->textLabel[i] != "") {
 								text = module->textLabel[i];
@@ -1857,6 +2274,9 @@ struct MidiCatWidget : ThemedModuleWidget<MidiCatModule>, ParamWidgetContextExte
 							else if (module->ccs[i].getCc() >= 0) {
 								text = string::f("MIDI CC %02d", module->ccs[i].getCc());
 							}
+							else if (module->ccs[i].getNrpn() >= 0) {
+								text = string::f("MIDI NRPN %d", module->ccs[i].getNrpn());
+							}
 							else {
 								static const char* noteNames[] = {
 									"C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B"
@@ -1896,7 +2316,7 @@ struct MidiCatWidget : ThemedModuleWidget<MidiCatModule>, ParamWidgetContextExte
 				w.push_back(construct<MapMenuItem>(&MenuItem::text, string::f("Re-map %s", midiCatId.c_str()), &MapMenuItem::module, module, &MapMenuItem::pq, pq, &MapMenuItem::currentId, id));
 				w.push_back(new SlewSlider(&module->midiParam[id]));
 				w.push_back(construct<MenuLabel>(&MenuLabel::text, "Scaling"));
-				std::string l = string::f("Input %s", module->ccs[id].getCc() >= 0 ? "MIDI CC" : (module->notes[id].getNote() >= 0 ? "MIDI vel" : ""));
+				std::string l = string::f("Input %s", module->ccs[id].getCc() >= 0 ? "MIDI CC" : (module->ccs[id].getNrpn() >= 0 ? "MIDI NRPN" : (module->notes[id].getNote() >= 0 ? "MIDI vel" : "")));
 				w.push_back(construct<ScalingInputLabel>(&MenuLabel::text, l, &ScalingInputLabel::p, &module->midiParam[id]));
 				w.push_back(construct<ScalingOutputLabel>(&MenuLabel::text, "Parameter range", &ScalingOutputLabel::p, &module->midiParam[id]));
 				w.push_back(new MinSlider(&module->midiParam[id]));
@@ -2080,6 +2500,20 @@ struct MidiCatWidget : ThemedModuleWidget<MidiCatModule>, ParamWidgetContextExte
 				menu->addChild(createBoolPtrMenuItem("Periodically", "", &module->midiResendPeriodically));
 			}
 		));
+		menu->addChild(StoermelderPackOne::Rack::createMapSubmenuItem<int>("MIDI feedback rate", {
+				{ 0, "Unlimited" },
+				{ 1000, "1000 messages/s" },
+				{ 500, "500 messages/s" },
+				{ 250, "250 messages/s" },
+				{ 100, "100 messages/s" }
+			},
+			[=]() {
+				return module->midiOutput.rateLimit;
+			},
+			[=](int rateLimit) {
+				module->midiOutput.rateLimit = rateLimit;
+			}
+		));
 		menu->addChild(createMenuItem("Import MIDI-MAP preset", "", [=]() { loadMidiMapPreset_dialog(); }));
 
 		menu->addChild(new MenuSeparator());
@@ -2151,8 +2585,8 @@ struct MidiCatWidget : ThemedModuleWidget<MidiCatModule>, ParamWidgetContextExte
 					midimapModuleItem->text = string::f("%s %s", a->pluginName.c_str(), a->moduleName.c_str());
 					midimapModuleItem->module = module;
 					midimapModuleItem->midimapModule = a;
-					midimapModuleItem->pluginSlug = it.first.first;
-					midimapModuleItem->moduleSlug = it.first.second;
+					midimapModuleItem->pluginSlug = a->pluginSlug;
+					midimapModuleItem->moduleSlug = a->moduleSlug;
 					l.push_back(std::pair<std::string, MidimapModuleItem*>(midimapModuleItem->text, midimapModuleItem));
 				}
 
@@ -2183,16 +2617,15 @@ struct MidiCatWidget : ThemedModuleWidget<MidiCatModule>, ParamWidgetContextExte
 
 				typedef std::pair<std::string, std::string> ppair;
 				std::list<std::pair<std::string, ppair>> list;
-				std::set<ppair> s;
+				std::set<uint64_t> s;
 				for (size_t i = 0; i < MAX_CHANNELS; i++) {
 					int64_t moduleId = module->paramHandles[i].moduleId;
 					if (moduleId < 0) continue;
 					Module* m = module->paramHandles[i].module;
-					auto q = ppair(m->model->plugin->slug, m->model->slug);
-					if (s.find(q) != s.end()) continue;
-					s.insert(q);
-
 					if (!m) continue;
+					if (!s.insert(memKey(m->model)).second) continue;
+
+					auto q = ppair(m->model->plugin->slug, m->model->slug);
 					std::string l = string::f("%s %s", m->model->plugin->name.c_str(), m->model->name.c_str());
 					auto p = std::pair<std::string, ppair>(l, q);
 					list.push_back(p);
@@ -1,10 +1,15 @@
 #pragma once
 #include "plugin.hpp"
+#include <unordered_map>
 
 namespace StoermelderPackOne {
 namespace MidiCat {
 
 static const int MAX_CHANNELS = 128;
+/** Number of slots checked for manual parameter changes every processDivision samples */
+static const int SCAN_SLOTS = 8;
+/** Maximum interval in seconds between MIDI messages of high resolution input which is ramped */
+static const float RAMP_MAX = 0.02f;
 
 #define MIDIOPTION_VELZERO_BIT 0
 
@@ -34,6 +39,7 @@ struct MemParam {
 	int cc = -1;
 	CCMODE ccMode;
 	bool cc14bit = false;
+	int nrpn = -1;
 	int note = -1;
 	NOTEMODE noteMode;
 	std::string label;
@@ -44,6 +50,8 @@ struct MemParam {
 };
 
 struct MemModule {
+	std::string pluginSlug;
+	std::string moduleSlug;
 	std::string pluginName;
 	std::string moduleName;
 	std::list<MemParam*> paramMap;
@@ -52,5 +60,37 @@ struct MemModule {
 	}
 };
 
+/** Stored mappings of MEM, indexed by the hash of plugin- and module-slug */
+typedef std::unordered_map<uint64_t, MemModule*> MemStorage;
+
+/** FNV-1a hash of plugin- and module-slug */
+inline uint64_t memKey(const std::string& pluginSlug, const std::string& moduleSlug) {
+	uint64_t h = 14695981039346656037ULL;
+	for (char c : pluginSlug) h = (h ^ uint8_t(c)) * 1099511628211ULL;
+	h = (h ^ uint8_t('/')) * 1099511628211ULL;
+	for (char c : moduleSlug) h = (h ^ uint8_t(c)) * 1099511628211ULL;
+	return h;
+}
+
+/** Hash of a model, computed only once for each model (UI thread only) */
+inline uint64_t memKey(Model* model) {
+	static std::unordered_map<Model*, uint64_t> cache;
+	auto it = cache.find(model);
+	if (it != cache.end()) return it->second;
+	uint64_t h = memKey(model->plugin->slug, model->slug);
+	cache[model] = h;
+	return h;
+}
+
+/** Returns the stored mapping of a model or NULL */
+inline MemModule* memFind(MemStorage* storage, Model* model) {
+	auto it = storage->find(memKey(model));
+	if (it == storage->end()) return NULL;
+	MemModule* a = it->second;
+	// Guard against hash collisions
+	if (a->moduleSlug != model->slug || a->pluginSlug != model->plugin->slug) return NULL;
+	return a;
+}
+
 } // namespace MidiCat
 } // namespace StoermelderPackOne
\ No newline at end of file
@@ -25,7 +25,7 @@ struct MidiCatMemModule : Module {
 	/** [Stored to JSON] */
 	int panelTheme = 0;
 	/** [Stored to JSON] */
-	std::map<std::pair<std::string, std::string>, MemModule*> midiMap;
+	MemStorage midiMap;
 
 	MidiCatMemModule() {
 		panelTheme = pluginSettings.panelThemeDefault;
@@ -60,10 +60,9 @@ struct MidiCatMemModule : Module {
 		json_t* midiMapJ = json_array();
 		for (auto it : midiMap) {
 			json_t* midiMapJJ = json_object();
-			json_object_set_new(midiMapJJ, "pluginSlug", json_string(it.first.first.c_str()));
-			json_object_set_new(midiMapJJ, "moduleSlug", json_string(it.first.second.c_str()));
-
 			auto a = it.second;
+			json_object_set_new(midiMapJJ, "pluginSlug", json_string(a->pluginSlug.c_str()));
+			json_object_set_new(midiMapJJ, "moduleSlug", json_string(a->moduleSlug.c_str()));
 			json_object_set_new(midiMapJJ, "pluginName", json_string(a->pluginName.c_str()));
 			json_object_set_new(midiMapJJ, "moduleName", json_string(a->moduleName.c_str()));
 			json_t* paramMapJ = json_array();
@@ -73,6 +72,7 @@ struct MidiCatMemModule : Module {
 				json_object_set_new(paramMapJJ, "cc", json_integer(p->cc));
 				json_object_set_new(paramMapJJ, "ccMode", json_integer((int)p->ccMode));
 				json_object_set_new(paramMapJJ, "cc14bit", json_boolean(p->cc14bit));
+				json_object_set_new(paramMapJJ, "nrpn", json_integer(p->nrpn));
 				json_object_set_new(paramMapJJ, "note", json_integer(p->note));
 				json_object_set_new(paramMapJJ, "noteMode", json_integer((int)p->noteMode));
 				json_object_set_new(paramMapJJ, "label", json_string(p->label.c_str()));
@@ -103,6 +103,8 @@ struct MidiCatMemModule : Module {
 			std::string moduleSlug = json_string_value(json_object_get(midiMapJJ, "moduleSlug"));
 
 			MemModule* a = new MemModule;
+			a->pluginSlug = pluginSlug;
+			a->moduleSlug = moduleSlug;
 			a->pluginName = json_string_value(json_object_get(midiMapJJ, "pluginName"));
 			a->moduleName = json_string_value(json_object_get(midiMapJJ, "moduleName"));
 			json_t* paramMapJ = json_object_get(midiMapJJ, "paramMap");
@@ -115,6 +117,8 @@ struct MidiCatMemModule : Module {
 				p->ccMode = (CCMODE)json_integer_value(json_object_get(paramMapJJ, "ccMode"));
 				json_t* cc14bitJ = json_object_get(paramMapJJ, "cc14bit");
 				if (cc14bitJ) p->cc14bit = json_boolean_value(cc14bitJ);
+				json_t* nrpnJ = json_object_get(paramMapJJ, "nrpn");
+				if (nrpnJ) p->nrpn = json_integer_value(nrpnJ);
 				p->note = json_integer_value(json_object_get(paramMapJJ, "note"));
 				p->noteMode = (NOTEMODE)json_integer_value(json_object_get(paramMapJJ, "noteMode"));
 				p->label = json_string_value(json_object_get(paramMapJJ, "label"));
@@ -127,7 +131,10 @@ struct MidiCatMemModule : Module {
 				if (maxJ) p->max = json_real_value(maxJ);
 				a->paramMap.push_back(p);
 			}
-			midiMap[std::pair<std::string, std::string>(pluginSlug, moduleSlug)] = a;
+			uint64_t key = memKey(pluginSlug, moduleSlug);
+			auto it = midiMap.find(key);
+			if (it != midiMap.end()) delete it->second;
+			midiMap[key] = a;
 		}
 	}
 };
@@ -8,6 +8,106 @@ namespace MidiMon {
 
 const int BUFFERSIZE = 800;
 
+/** Unformatted entry of the MIDI log, formatted on the UI thread when shown */
+struct MidiLogEntry {
+	enum class TYPE {
+		MIDI,
+		TIME,
+		SAMPLERATE
+	};
+	TYPE type;
+	float timestamp;
+	uint8_t bytes[3];
+	/** Size of the MIDI message */
+	int size;
+	/** Time of TYPE::TIME or sample rate of TYPE::SAMPLERATE */
+	int64_t value;
+
+	std::string format() const {
+		switch (type) {
+			case TYPE::TIME: {
+				std::time_t t = std::time_t(value);
+				char buf[100] = {0};
+				std::strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", std::localtime(&t));
+				return std::string(buf);
+			}
+			case TYPE::SAMPLERATE: {
+				return string::f("sample rate %i", int(value));
+			}
+			default: {
+				break;
+			}
+		}
+
+		uint8_t ch = bytes[0] & 0xf;
+		switch (bytes[0] >> 4) {
+			case 0x9: // note on
+				return string::f("ch%i note on  %i vel %i", ch + 1, bytes[1], bytes[2]);
+			case 0x8: // note off
+				return string::f("ch%i note off %i vel %i", ch + 1, bytes[1], bytes[2]);
+			case 0xa: // key pressure
+				return string::f("ch%i key-pressure %i vel %i", ch + 1, bytes[1], bytes[2]);
+			case 0xb: // cc
+				return string::f("ch%i cc%i=%i", ch + 1, bytes[1], int8_t(bytes[2]));
+			case 0xc: // program change
+				return string::f("ch%i program=%i", ch + 1, bytes[1]);
+			case 0xd: // channel pressure
+				return string::f("ch%i channel-pressure=%i", ch + 1, bytes[1]);
+			case 0xe: // pitch wheel
+				return string::f("ch%i pitchwheel=%i", ch + 1, ((uint16_t)bytes[2] << 7) | bytes[1]);
+			case 0xf: // system
+				switch (ch) {
+					case 0x0: // sysex
+						return string::f("sysex message=%i bytes", size);
+					case 0x2: // song pointer
+						return string::f("song pointer=%i", ((uint16_t)bytes[2] << 7) | bytes[1]);
+					case 0x3: // song select
+						return string::f("song select=%i", bytes[1]);
+					case 0x8: // timing clock
+						return "clock tick";
+					case 0xa: // start
+						return "start";
+					case 0xb: // continue
+						return "continue";
+					case 0xc: // stop
+						return "stop";
+					default:
+						break;
+				}
+				break;
+			default:
+				break;
+		}
+		return "";
+	}
+};
+
+/** Log of MIDI messages on the UI thread, the newest entry comes first */
+struct MidiLog {
+	MidiLogEntry entries[BUFFERSIZE];
+	size_t start = 0;
+	size_t count = 0;
+
+	void push(const MidiLogEntry& e) {
+		start = (start + BUFFERSIZE - 1) % BUFFERSIZE;
+		entries[start] = e;
+		if (count < BUFFERSIZE) count++;
+	}
+
+	const MidiLogEntry& get(size_t i) const {
+		return entries[(start + i) % BUFFERSIZE];
+	}
+
+	size_t size() const {
+		return count;
+	}
+
+	void clear() {
+		start = 0;
+		count = 0;
+	}
+};
+
 struct MidiMonModule : Module {
 	enum ParamIds {
 		NUM_PARAMS
@@ -48,7 +148,7 @@ struct MidiMonModule : Module {
 	/** [Stored to JSON] */
 	midi::InputQueue midiInput;
 
-	dsp::RingBuffer<std::tuple<float, std::string>, 512> midiLogMessages;
+	dsp::RingBuffer<MidiLogEntry, 512> midiLogMessages;
 	uint64_t sample;
 
 	MidiMonModule() {
@@ -78,11 +178,14 @@ struct MidiMonModule : Module {
 	}
 
 	void resetTimestamp() {
-		std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-		char buf[100] = {0};
-		std::strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", std::localtime(&now));
-		midiLogMessages.push(std::make_tuple(0.f, std::string(buf)));
-		midiLogMessages.push(std::make_tuple(0.f, string::f("sample rate %i", int(APP->engine->getSampleRate()))));
+		MidiLogEntry e;
+		e.type = MidiLogEntry::TYPE::TIME;
+		e.timestamp = 0.f;
+		e.value = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+		midiLogMessages.push(e);
+		e.type = MidiLogEntry::TYPE::SAMPLERATE;
+		e.value = APP->engine->getSampleRate();
+		midiLogMessages.push(e);
 		sample = 0;
 	}
 
@@ -95,105 +198,52 @@ struct MidiMonModule : Module {
 	}
 
 	void processMidi(midi::Message& msg) {
-		float timestamp = float(sample) / APP->engine->getSampleRate();
+		if (midiLogMessages.full()) return;
+		bool show = false;
 		switch (msg.getStatus()) {
 			case 0x9: // note on
-				if (!midiLogMessages.full() && showNoteMsg) {
-					uint8_t ch = msg.getChannel();
-					uint8_t note = msg.getNote();
-					uint8_t vel = msg.getValue();
-					std::string s = string::f("ch%i note on  %i vel %i", ch + 1, note, vel);
-					midiLogMessages.push(std::make_tuple(timestamp, s));
-				} break;
 			case 0x8: // note off
-				if (!midiLogMessages.full() && showNoteMsg) {
-					uint8_t ch = msg.getChannel();
-					uint8_t note = msg.getNote();
-					uint8_t vel = msg.getValue();
-					std::string s = string::f("ch%i note off %i vel %i", ch + 1, note, vel);
-					midiLogMessages.push(std::make_tuple(timestamp, s));
-				} break;
+				show = showNoteMsg; break;
 			case 0xa: // key pressure
-				if (!midiLogMessages.full() && showKeyPressure) {
-					uint8_t ch = msg.getChannel();
-					uint8_t note = msg.getNote();
-					uint8_t value = msg.getValue();
-					std::string s = string::f("ch%i key-pressure %i vel %i", ch + 1, note, value);
-					midiLogMessages.push(std::make_tuple(timestamp, s));
-				} break;
+				show = showKeyPressure; break;
 			case 0xb: // cc
-				if (!midiLogMessages.full() && showCcMsg) {
-					uint8_t ch = msg.getChannel();
-					uint8_t cc = msg.getNote();
-					int8_t value = msg.bytes[2];
-					std::string s = string::f("ch%i cc%i=%i", ch + 1, cc, value);
-					midiLogMessages.push(std::make_tuple(timestamp, s));
-				} break;
+				show = showCcMsg; break;
 			case 0xc: // program change
-				if (!midiLogMessages.full() && showProgChangeMsg) {
-					uint8_t ch = msg.getChannel();
-					uint8_t prog = msg.getNote();
-					std::string s = string::f("ch%i program=%i", ch + 1, prog);
-					midiLogMessages.push(std::make_tuple(timestamp, s));
-				} break;
+				show = showProgChangeMsg; break;
 			case 0xd: // channel pressure
-				if (!midiLogMessages.full() && showChannelPressurelMsg) {
-					uint8_t ch = msg.getChannel();
-					uint8_t value = msg.getNote();
-					std::string s = string::f("ch%i channel-pressure=%i", ch + 1, value);
-					midiLogMessages.push(std::make_tuple(timestamp, s));
-				} break;
+				show = showChannelPressurelMsg; break;
 			case 0xe: // pitch wheel
-				if (!midiLogMessages.full() && showPitchWheelMsg) {
-					uint8_t ch = msg.getChannel();
-					uint16_t value = ((uint16_t)msg.getValue() << 7) | msg.getNote();
-					std::string s = string::f("ch%i pitchwheel=%i", ch + 1, value);
-					midiLogMessages.push(std::make_tuple(timestamp, s));
-				} break;
+				show = showPitchWheelMsg; break;
 			case 0xf: // system
-				if (!midiLogMessages.full()) {
-					switch (msg.getChannel()) {
-						case 0x0: // sysex
-							if (showSysExMsg) {
-								std::string s = string::f("sysex message=%i bytes", msg.getSize());
-								midiLogMessages.push(std::make_tuple(timestamp, s));
-							} break;
-						case 0x2: // song pointer
-							if (showSystemMsg) {
-								uint16_t value = ((uint16_t)msg.getValue() << 7) | msg.getNote();
-								std::string s = string::f("song pointer=%i", value);
-								midiLogMessages.push(std::make_tuple(timestamp, s));
-							} break;
-						case 0x3: // song select
-							if (showSystemMsg) {
-								uint8_t song = msg.getNote();
-								std::string s = string::f("song select=%i", song);
-								midiLogMessages.push(std::make_tuple(timestamp, s));
-							} break;
-						case 0x8: // timing clock
-							if (showClockMsg) {
-								midiLogMessages.push(std::make_tuple(timestamp, "clock tick"));
-							} break;
-						case 0xa: // start
-							if (showSystemMsg) {
-								midiLogMessages.push(std::make_tuple(timestamp, "start"));
-							} break;
-						case 0xb: // continue
-							if (showSystemMsg) {
-								midiLogMessages.push(std::make_tuple(timestamp, "continue"));
-							} break;
-						case 0xc: // stop
-							if (showSystemMsg) {
-								midiLogMessages.push(std::make_tuple(timestamp, "stop"));
-							} break;
-						default:
-							break;
-					}
+				switch (msg.getChannel()) {
+					case 0x0: // sysex
+						show = showSysExMsg; break;
+					case 0x8: // timing clock
+						show = showClockMsg; break;
+					case 0x2: // song pointer
+					case 0x3: // song select
+					case 0xa: // start
+					case 0xb: // continue
+					case 0xc: // stop
+						show = showSystemMsg; break;
+					default:
+						break;
 				}
 				break;
 			default:
 				break;
 		}
+		if (!show) return;
+
+		// Only the raw message is stored, formatting is done on the UI thread
+		MidiLogEntry e;
+		e.type = MidiLogEntry::TYPE::MIDI;
+		e.timestamp = float(sample) / APP->engine->getSampleRate();
+		e.size = msg.getSize();
+		for (int i = 0; i < 3; i++) {
+			e.bytes[i] = i < e.size ? msg.bytes[i] : 0;
+		}
+		midiLogMessages.push(e);
 	}
 
 	json_t* dataToJson() override {
@@ -237,7 +287,7 @@ struct MidiMonModule : Module {
 
 struct MidiDisplay : LedTextDisplay {
 	MidiMonModule* module;
-	std::list<std::tuple<float, std::string>>* buffer;
+	MidiLog* buffer;
 	bool dirty = true;
 
 	MidiDisplay() {
@@ -248,14 +298,14 @@ struct MidiDisplay : LedTextDisplay {
 	void step() override {
 		LedTextDisplay::step();
 		if (dirty) {
+			// Only visible lines are formatted
 			text = "";
 			size_t size = std::min(buffer->size(), (size_t)(box.size.x / fontSize - 1));
-			size_t i = 0;
-			for (std::tuple<float, std::string> s : *buffer) {
-				if (i >= size) break;
-				text += string::f("[%9.4f] %s\n", std::get<0>(s), std::get<1>(s).c_str());
-				i++;
+			for (size_t i = 0; i < size; i++) {
+				const MidiLogEntry& e = buffer->get(i);
+				text += string::f("[%9.4f] %s\n", e.timestamp, e.format().c_str());
 			}
+			dirty = false;
 		}
 	}
 
@@ -268,7 +318,7 @@ struct MidiDisplay : LedTextDisplay {
 
 struct MidiMonWidget : ThemedModuleWidget<MidiMonModule> {
 	MidiDisplay* textField;
-	std::list<std::tuple<float, std::string>> buffer;
+	MidiLog buffer;
 	
 	MidiMonWidget(MidiMonModule* module)
 		: ThemedModuleWidget<MidiMonModule>(module, "MidiMon") {
@@ -296,9 +346,7 @@ struct MidiMonWidget : ThemedModuleWidget<MidiMonModule> {
 		if (!module) return;
 		MidiMonModule* module = reinterpret_cast<MidiMonModule*>(this->module);
 		while (!module->midiLogMessages.empty()) {
-			if (buffer.size() == BUFFERSIZE) buffer.pop_back();
-			std::tuple<float, std::string> s = module->midiLogMessages.shift();
-			buffer.push_front(s);
+			buffer.push(module->midiLogMessages.shift());
 			textField->dirty = true;
 		}
 	}
@@ -370,9 +418,9 @@ struct MidiMonWidget : ThemedModuleWidget<MidiMonModule> {
 		fputs(string::f("MIDI channel: %s\n", module->midiInput.getChannelName(module->midiInput.channel).c_str()).c_str(), file);
 		fputs("--------------------------------------------------------------------\n", file);
 
-		for (std::list<std::tuple<float, std::string>>::reverse_iterator rit = buffer.rbegin(); rit != buffer.rend(); rit++) {
-			std::tuple<float, std::string> s = *rit;
-			fputs(string::f("[%11.4f] %s\n", std::get<0>(s), std::get<1>(s).c_str()).c_str(), file);
+		for (size_t i = buffer.size(); i > 0; i--) {
+			const MidiLogEntry& e = buffer.get(i - 1);
+			fputs(string::f("[%11.4f] %s\n", e.timestamp, e.format().c_str()).c_str(), file);
 		}
 	}
 
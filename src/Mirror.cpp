@@ -55,6 +55,8 @@ struct MirrorModule : Module, StripIdFixModule {
 	dsp::ClockDivider handleDivider;
 
 	TaskProcessor<> taskProcessorUi;
+	/** Set by the engine thread if target handles need to be unmapped on the UI-thread */
+	std::atomic<bool> handlesUnmapPending{false};
 
 	MirrorModule() {
 		panelTheme = pluginSettings.panelThemeDefault;
@@ -103,7 +105,7 @@ struct MirrorModule : Module, StripIdFixModule {
 
 			// Enqueue on the UI-thread as the engine's mutex could already be locked
 			if (createUiTask) {
-				taskProcessorUi.enqueue(cleanHandles);
+				taskProcessorUi.enqueue(std::move(cleanHandles));
 			}
 			else {
 				cleanHandles();
@@ -124,6 +126,19 @@ struct MirrorModule : Module, StripIdFixModule {
 		audioRate = false;
 	}
 
+	/** Unmaps target parameters whose source parameter has been unmapped, called on the UI-thread */
+	void handlesUnmap() {
+		handlesUnmapPending = false;
+		if (sourceHandles.empty()) return;
+		for (size_t j = 0; j < targetHandles.size(); j++) {
+			ParamHandle* sourceHandle = sourceHandles[j % sourceHandles.size()];
+			ParamHandle* targetHandle = targetHandles[j];
+			if (sourceHandle->moduleId < 0 && targetHandle->moduleId >= 0) {
+				APP->engine->updateParamHandle(targetHandle, -1, 0, true);
+			}
+		}
+	}
+
 	void process(const ProcessArgs& args) override {
 		if (inChange) return;
 
@@ -134,27 +149,17 @@ struct MirrorModule : Module, StripIdFixModule {
 				sourceHandle->color = mappingIndicatorHidden ? color::BLACK_TRANSPARENT : nvgRGB(0x40, 0xff, 0xff);
 
 				size_t j = i;
-				std::list<std::function<void()>> handleList;
 				while (j < targetHandles.size()) {
 					ParamHandle* targetHandle = targetHandles[j];
 					targetHandle->color = mappingIndicatorHidden ? color::BLACK_TRANSPARENT : nvgRGB(0xff, 0x40, 0xff);
 					if (sourceHandle->moduleId < 0 && targetHandle->moduleId >= 0) {
-						// Unmap target parameter
-						// This might cause a deadlock as the engine's mutex could already be locked
-						handleList.push_back([targetHandle]() {
-							APP->engine->updateParamHandle(targetHandle, -1, 0, true);
-						});
+						// Unmap target parameter on the UI-thread
+						// Doing it here might cause a deadlock as the engine's mutex could already be locked
+						handlesUnmapPending = true;
 					}
 
 					j += sourceHandles.size();
 				}
-
-				// Enqueue on the UI-thread for cleaning up ParamHandles
-				if (handleList.size() > 0) {
-					taskProcessorUi.enqueue([handleList]() {
-						for (std::function<void()> f : handleList) f();
-					});
-				}
 			}
 		}
 
@@ -430,7 +435,10 @@ struct MirrorWidget : ThemedModuleWidget<MirrorModule> {
 
 	void step() override {
 		ThemedModuleWidget<MirrorModule>::step();
-		if (module) module->taskProcessorUi.process();
+		if (module) {
+			module->taskProcessorUi.process();
+			if (module->handlesUnmapPending && !module->inChange) module->handlesUnmap();
+		}
 	}
 
 	void appendContextMenu(Menu* menu) override {
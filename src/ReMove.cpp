@@ -1,14 +1,27 @@
 #include "plugin.hpp"
 #include "MapModuleBase.hpp"
 #include "components/Knobs.hpp"
-#include <thread>
+#include "helpers/TaskWorker.hpp"
+#include <mutex>
+#include <atomic>
 #include <random>
 
 namespace StoermelderPackOne {
 namespace ReMove {
 
-const int REMOVE_MAX_DATA = 64 * 1024;
 const int REMOVE_MAX_SEQ = 8;
+/** number of values in a chunk of recorded data, must be a power of 2 */
+const int REMOVE_CHUNK_SIZE = 4096;
+/** maximum number of chunks for a single sequence */
+const int REMOVE_MAX_CHUNKS = 1024;
+/** upper limit for the recorded data of all sequences, number of values */
+const int REMOVE_MAX_DATA = REMOVE_MAX_CHUNKS * REMOVE_CHUNK_SIZE;
+/** number of preallocated chunks available to the engine thread while recording */
+const int REMOVE_CHUNK_POOL = 8;
+/** size of the buffer between recording and compaction, holds 0.5s at the highest sample rate */
+const int REMOVE_REC_BUFFER = 1024;
+/** interval for handing recorded values to the compaction worker in milliseconds */
+const int REMOVE_COMPACT_INTERVAL = 20;
 
 enum RECMODE {
     RECMODE_TOUCH = 0,
@@ -61,6 +74,43 @@ const int REMOVE_PLAYDIR_FWD = 1;
 const int REMOVE_PLAYDIR_REV = -1;
 const int REMOVE_PLAYDIR_NONE = 0;
 
+enum DRAGSTATE {
+    DRAGSTATE_NONE = 0,
+    DRAGSTATE_OTHER = 1,
+    DRAGSTATE_PARAM = 2
+};
+
+enum RECEVENT {
+    RECEVENT_RESET = 0,
+    RECEVENT_APPEND = 1,
+    RECEVENT_TRIM = 2
+};
+
+/** Event passed from the recording engine thread to the compaction worker */
+struct RecEvent {
+    RECEVENT type;
+    int seq;
+    float value;
+    int length;
+};
+
+/** Run of equal values in a compacted sequence */
+struct SeqRun {
+    float value;
+    int count;
+};
+
+enum RECHISTORY {
+    RECHISTORY_START = 0,
+    RECHISTORY_STOP = 1
+};
+
+/** Start or stop of a recording, passed from the engine thread to the widget for undo history */
+struct RecHistoryEvent {
+    RECHISTORY type;
+    int seq;
+};
+
 
 struct ReMoveModule : MapModuleBase<1> {
     enum ParamIds {
@@ -99,17 +149,27 @@ struct ReMoveModule : MapModuleBase<1> {
     /** [Stored to JSON] */
     bool audioRate;
 
-    /** [Stored to JSON] recorded data */
-    float *seqData;
-    /** stores the current position in data */
+    /** [Stored to JSON] recorded data, chunks of REMOVE_CHUNK_SIZE values for each sequence */
+    float* seqData[REMOVE_MAX_SEQ][REMOVE_MAX_CHUNKS];
+    /** number of allocated chunks for each sequence */
+    int seqChunks[REMOVE_MAX_SEQ];
+    /** [Stored to JSON] memory limit for the recorded data of all sequences, number of values */
+    int seqMaxData = 256 * 1024;
+    /** chunks allocated by the worker, taken by the engine thread while recording */
+    dsp::RingBuffer<float*, REMOVE_CHUNK_POOL> chunkPool;
+    /** number of allocated chunks including chunkPool and chunkFree */
+    std::atomic<int> chunkCount{0};
+    /** chunks released by the engine thread, reused or deleted by the worker */
+    dsp::RingBuffer<float*, REMOVE_MAX_CHUNKS> chunkFree;
+    /** requests the engine thread to release chunks not needed for the recorded data */
+    std::atomic<bool> chunkTrim{false};
+    /** stores the current position in the current sequence */
     int dataPtr = 0;
 
     /** [Stored to JSON] number of sequences */
     int seqCount = 4;
     /** [Stored to JSON] currently selected sequence */
     int seq = 0;
-    int seqLow;
-    int seqHigh;
     /** [Stored to JSON] length of the seqences */
     int seqLength[REMOVE_MAX_SEQ];
 
@@ -171,11 +231,26 @@ struct ReMoveModule : MapModuleBase<1> {
     dsp::ClockDivider processDivider;
 	dsp::ClockDivider lightDivider;
 
-    /** last touched parameter to avoid frequent dynamic casting */
-    Widget *lastParamWidget;
+    /** mouse dragging state of the mapped parameter, published by the widget */
+    std::atomic<DRAGSTATE> dragState{DRAGSTATE_NONE};
+
+    /** recorded values, written by the engine thread and consumed by the worker */
+    dsp::RingBuffer<RecEvent, REMOVE_REC_BUFFER> recBuffer;
+    /** run-length compacted sequences used for saving, guarded by workerMutex */
+    std::vector<SeqRun> seqRuns[REMOVE_MAX_SEQ];
+    /** set when recBuffer overflowed, the sequence is compacted from seqData on saving */
+    std::atomic<bool> seqRunsInvalid[REMOVE_MAX_SEQ];
+
+    std::mutex workerMutex;
+    TaskWorker taskWorker;
+    dsp::Timer workerTimer;
 
-    /** history-item when starting recording */
-    history::ModuleChange *recChangeHistory = NULL;
+    /** starts and stops of recordings, the widget creates the history-items */
+    dsp::RingBuffer<RecHistoryEvent, 8> recHistory;
+    /** sequence before the last recording has been started, guarded by workerMutex */
+    std::vector<SeqRun> recUndoRuns;
+    int recUndoSeq = -1;
+    bool recUndoValid = false;
 
     ReMoveModule() {
         panelTheme = pluginSettings.panelThemeDefault;
@@ -187,17 +262,22 @@ struct ReMoveModule : MapModuleBase<1> {
         configParam<TriggerParamQuantity>(REC_PARAM, 0.0f, 1.0f, 0.0f, "Record");
         configParam(SLEW_PARAM, 0.0f, 0.975f, 0.0f, "Slew");
 
-        seqData = new float[REMOVE_MAX_DATA];
+        for (int i = 0; i < REMOVE_MAX_SEQ; i++) seqChunks[i] = 0;
         this->mappingIndicatorColor = nvgRGB(0x40, 0xff, 0xff);
         paramHandles[0].text = "ReMove Lite";
 
         processDivider.setDivision(64);
         lightDivider.setDivision(1024);
         onReset();
+        chunkPoolFill();
+        taskWorker.postHandler = [this](int) { processWorker(); };
     }
 
     ~ReMoveModule() {
-        delete[] seqData;
+        taskWorker.stop();
+        seqFree();
+        while (chunkPool.size() > 0) delete[] chunkPool.shift();
+        while (chunkFree.size() > 0) delete[] chunkFree.shift();
     }
 
     void onReset() override {
@@ -219,6 +299,21 @@ struct ReMoveModule : MapModuleBase<1> {
         engineSampleTime = args.sampleTime;
         outputs[REC_OUTPUT].setVoltage(0);
 
+        // Release chunks after resizing, re-recording or lowering the memory limit
+        if (chunkTrim && !isRecording) {
+            chunkTrim = false;
+            seqTrim();
+        }
+
+        // Hand recorded values to the worker and refill the chunk pool in intervals
+        if (workerTimer.process(args.sampleTime) >= REMOVE_COMPACT_INTERVAL * 1e-3f) {
+            workerTimer.reset();
+            if (recBuffer.size() > 0 || chunkFree.size() > 0 || (!chunkPool.full() && chunkCount * REMOVE_CHUNK_SIZE < seqMaxData)) {
+                taskWorker.post(0);
+            }
+        }
+        taskWorker.postPoll();
+
         // Toggle record when button is pressed
         if (recTrigger.process(params[REC_PARAM].getValue() + inputs[REC_INPUT].getVoltage())) {
             isPlaying = false;
@@ -240,19 +335,9 @@ struct ReMoveModule : MapModuleBase<1> {
 
             if (recMode == RECMODE_TOUCH && !recTouched) {
                 // check if mouse has been pressed on parameter
-                Widget *w = APP->event->getDraggedWidget();
-                if (w != NULL && w != lastParamWidget) {
-                    lastParamWidget = w;
-                    // it is not a good idea to do dynamic casting in the DSP thread,
-                    // so do this only once for each touched widget
-                    ParamWidget *pw = dynamic_cast<ParamWidget*>(w);
-                    if (pw != NULL && pw->getParamQuantity() == getParamQuantity(0)) {
-                        recTouched = true;
-                        recOutCvPulse.trigger();
-                    }
-                    else {
-                        doRecord = false;
-                    }
+                if (dragState == DRAGSTATE_PARAM) {
+                    recTouched = true;
+                    recOutCvPulse.trigger();
                 }
                 else {
                     doRecord = false;
@@ -273,39 +358,45 @@ struct ReMoveModule : MapModuleBase<1> {
             if (doRecord) {
                 if (sampleTimer.process(args.sampleTime) > sampleRate) {
                     // check if mouse button has been released
-                    if (APP->event->getDraggedWidget() == NULL) {
+                    if (dragState == DRAGSTATE_NONE) {
                         if (recMode == RECMODE_TOUCH) {
                             stopRecording();
                         }
                         if (recMode == RECMODE_MOVE) {
                             stopRecording();
                             // trim unchanged values from the end
-                            int i = seqLow + seqLength[seq] - 1;
-                            if (i > seqLow) {
-                                float l = seqData[i];
-                                while (i > seqLow && l == seqData[i - 1]) i--;
-                                seqLength[seq] = i - seqLow;
+                            int i = seqLength[seq] - 1;
+                            if (i > 0) {
+                                float l = seqValue(seq, i);
+                                while (i > 0 && l == seqValue(seq, i - 1)) i--;
+                                seqLength[seq] = i;
+                                recPush(RECEVENT_TRIM, 0.f, seqLength[seq]);
                             }
                         } 
                     }
                     
+                    // Stop recording when the memory limit is reached
+                    if (isRecording && !seqReady()) {
+                        stopRecording();
+                    }
+
                     // Are we still recording?
                     if (isRecording) {
-                        seqData[dataPtr] = getValue();
+                        seqValue(seq, dataPtr) = getValue();
 
                         // Push value on parameter only when CV input is been used
                         ParamQuantity* paramQuantity = NULL;
                         if (inputs[CV_INPUT].isConnected()) paramQuantity = getParamQuantity(0);
-                        setValue(seqData[dataPtr], paramQuantity);
+                        setValue(seqValue(seq, dataPtr), paramQuantity);
+                        recPush(RECEVENT_APPEND, seqValue(seq, dataPtr));
                         seqLength[seq]++;
                         dataPtr++;
-                        // Stop recording when end of sequence is reached
-                        if (dataPtr == seqHigh) {
-                            stopRecording();
-                        }
                         if (recMode == RECMODE_SAMPLEHOLD) {
-                            seqData[dataPtr] = seqData[dataPtr - 1];
-                            seqLength[seq]++;
+                            if (seqReady()) {
+                                seqValue(seq, dataPtr) = seqValue(seq, dataPtr - 1);
+                                recPush(RECEVENT_APPEND, seqValue(seq, dataPtr));
+                                seqLength[seq]++;
+                            }
                             stopRecording();
                         }
                     }
@@ -330,7 +421,7 @@ struct ReMoveModule : MapModuleBase<1> {
 
             // RESET-input: reset ptr when button is pressed or input is triggered
             if (resetCvTrigger.process(params[RESET_PARAM].getValue() + inputs[RESET_INPUT].getVoltage())) {
-                dataPtr = seqLow;
+                dataPtr = 0;
                 playDir = REMOVE_PLAYDIR_FWD;
                 sampleTimer.reset();
                 valueFilters[0].reset();
@@ -377,10 +468,10 @@ struct ReMoveModule : MapModuleBase<1> {
                 isPlaying = false;
                 if (audioRate || processDivider.process()) {
                     ParamQuantity *paramQuantity = getParamQuantity(0);
-                    if (paramQuantity != NULL) {
+                    if (paramQuantity != NULL && seqLength[seq] > 0) {
                         float v = clamp(inputs[PHASE_INPUT].getVoltage(), 0.f, 10.f);
-                        dataPtr = floor(rescale(v, 0.f, 10.f, seqLow, seqLow + seqLength[seq] - 1));
-                        v = seqData[dataPtr];
+                        dataPtr = floor(rescale(v, 0.f, 10.f, 0, seqLength[seq] - 1));
+                        v = seqValue(seq, dataPtr);
                         setValue(v, paramQuantity);
                     }
                 }
@@ -394,13 +485,13 @@ struct ReMoveModule : MapModuleBase<1> {
 
                     // are we still playing?
                     if (isPlaying && seqLength[seq] > 0) {
-                        float v = seqData[dataPtr];
+                        float v = seqValue(seq, dataPtr);
                         dataPtr = dataPtr + playDir;
                         setValue(v, paramQuantity);
-                        if (dataPtr == seqLow + seqLength[seq] && playDir == REMOVE_PLAYDIR_FWD) {
+                        if (dataPtr == seqLength[seq] && playDir == REMOVE_PLAYDIR_FWD) {
                             switch (playMode) {
                                 case PLAYMODE_LOOP: 
-                                    dataPtr = seqLow; break;
+                                    dataPtr = 0; break;
                                 case PLAYMODE_ONESHOT:      // stay on last value
                                     dataPtr--; playDir = REMOVE_PLAYDIR_NONE; break;
                                 case PLAYMODE_PINGPONG:     // reverse direction
@@ -411,7 +502,7 @@ struct ReMoveModule : MapModuleBase<1> {
                                     seqRand(); break;
                             }
                         }
-                        if (dataPtr == seqLow - 1) {
+                        if (dataPtr == -1) {
                             dataPtr++; playDir = REMOVE_PLAYDIR_FWD;
                         }
                     }
@@ -498,7 +589,7 @@ struct ReMoveModule : MapModuleBase<1> {
                 outputs[CV_OUTPUT].setVoltage(rescale(v, 0.f, 1.f, -5.f, 5.f));
                 break;
             case OUTCVMODE_EOC:
-                if (dataPtr == seqLow + seqLength[seq] && playDir == REMOVE_PLAYDIR_FWD) {
+                if (dataPtr == seqLength[seq] && playDir == REMOVE_PLAYDIR_FWD) {
                     switch (playMode) {
                         case PLAYMODE_LOOP:
                         case PLAYMODE_ONESHOT:
@@ -510,7 +601,7 @@ struct ReMoveModule : MapModuleBase<1> {
                             break;
                     }
                 }
-                if (dataPtr == seqLow - 1) {
+                if (dataPtr == -1) {
                     outCvPulse.trigger();
                 }
                 break;
@@ -524,14 +615,15 @@ struct ReMoveModule : MapModuleBase<1> {
     }
 
     void startRecording() {
-        // history::ModuleChange
-        recChangeHistory = new history::ModuleChange;
-        recChangeHistory->name = "ReMOVE recording";
-        recChangeHistory->moduleId = this->id;
-        recChangeHistory->oldModuleJ = toJson();
+        if (!recHistory.full()) recHistory.push(RecHistoryEvent{RECHISTORY_START, seq});
 
         seqLength[seq] = 0;
-        dataPtr = seqLow;
+        // The compacted sequence replaced by the reset is kept for undo if it is complete
+        bool invalid = seqRunsInvalid[seq];
+        // A successfully queued reset starts a valid compacted sequence
+        if (!recBuffer.full()) seqRunsInvalid[seq] = false;
+        recPush(RECEVENT_RESET, 0.f, invalid ? 1 : 0);
+        dataPtr = 0;
         sampleTimer.reset();
         if (!inputs[CV_INPUT].isConnected()) paramHandles[0].color = nvgRGB(0xff, 0x40, 0xff);
         recTouch = getValue();
@@ -540,17 +632,15 @@ struct ReMoveModule : MapModuleBase<1> {
 
     void stopRecording() {
         isRecording = false;
-        if (dataPtr != seqLow) recOutCvPulse.trigger();
-        dataPtr = seqLow;
+        if (dataPtr != 0) recOutCvPulse.trigger();
+        dataPtr = 0;
         sampleTimer.reset();
         paramHandles[0].color = nvgRGB(0x40, 0xff, 0xff);
         valueFilters[0].reset();
 
-        if (recChangeHistory) {
-            recChangeHistory->newModuleJ = toJson();
-            APP->history->push(recChangeHistory);
-            recChangeHistory = NULL;
-        }
+        if (!recHistory.full()) recHistory.push(RecHistoryEvent{RECHISTORY_STOP, seq});
+        // A shorter take leaves chunks of the previous one unused
+        chunkTrim = true;
 
         if (recAutoplay) {
             isPlaying = true;
@@ -593,26 +683,222 @@ struct ReMoveModule : MapModuleBase<1> {
         dataPtr = 0;
         for (int i = 0; i < REMOVE_MAX_SEQ; i++) seqLength[i] = 0;
         seqUpdate();
+        seqRunsRebuild();
+        chunkTrim = true;
     }
 
     inline void seqUpdate() {
-        int s = REMOVE_MAX_DATA / seqCount;
-        seqLow = seq * s;
-        seqHigh =  (seq + 1) * s;
         switch (seqChangeMode) {
             case SEQCHANGEMODE_RESTART:
-                dataPtr = seqLow;
+                dataPtr = 0;
                 playDir = REMOVE_PLAYDIR_FWD;
                 sampleTimer.reset();
                 valueFilters[0].reset();
                 break;
             case SEQCHANGEMODE_OFFSET:
-                dataPtr = seqLength[seq] > 0 ? seqLow + (dataPtr % s) % seqLength[seq] : seqLow;
+                dataPtr = seqLength[seq] > 0 ? dataPtr % seqLength[seq] : 0;
                 break;
         }
     }
 
 
+    inline float& seqValue(int s, int i) {
+        return seqData[s][i / REMOVE_CHUNK_SIZE][i % REMOVE_CHUNK_SIZE];
+    }
+
+    /** Makes sure the value at dataPtr can be recorded, takes a chunk from the pool if needed */
+    inline bool seqReady() {
+        if (dataPtr < seqChunks[seq] * REMOVE_CHUNK_SIZE) return true;
+        if (seqChunks[seq] == REMOVE_MAX_CHUNKS || chunkPool.size() == 0) return false;
+        seqData[seq][seqChunks[seq]++] = chunkPool.shift();
+        return true;
+    }
+
+    /** Returns the number of values which can still be recorded on the current sequence */
+    int seqRemaining() {
+        int used = chunkCount - (int)chunkPool.size();
+        return seqChunks[seq] * REMOVE_CHUNK_SIZE - dataPtr + std::max(seqMaxData - used * REMOVE_CHUNK_SIZE, 0);
+    }
+
+    /**
+     * Reserves a chunk within the memory limit before it is allocated, returns false if the
+     * limit has been reached. Safe to be called by the worker and on patch loading at the same time.
+     */
+    bool chunkReserve() {
+        int c = chunkCount.load();
+        while (c * REMOVE_CHUNK_SIZE < seqMaxData) {
+            if (chunkCount.compare_exchange_weak(c, c + 1)) return true;
+        }
+        return false;
+    }
+
+    /**
+     * Hands chunks beyond the recorded length of each sequence to the worker.
+     * chunkFree holds all chunks within the memory limit, so it never overflows.
+     * To be called from the engine thread only.
+     */
+    void seqTrim() {
+        for (int i = 0; i < REMOVE_MAX_SEQ; i++) {
+            int length = i < seqCount ? seqLength[i] : 0;
+            int keep = (length + REMOVE_CHUNK_SIZE - 1) / REMOVE_CHUNK_SIZE;
+            while (seqChunks[i] > keep) chunkFree.push(seqData[i][--seqChunks[i]]);
+        }
+    }
+
+    /** Returns released chunks to the pool or deletes them, called by the worker */
+    void chunkFreeProcess() {
+        while (chunkFree.size() > 0) {
+            float* chunk = chunkFree.shift();
+            if (!chunkPool.full() && chunkCount * REMOVE_CHUNK_SIZE <= seqMaxData) {
+                chunkPool.push(chunk);
+            }
+            else {
+                delete[] chunk;
+                chunkCount--;
+            }
+        }
+    }
+
+    /** Keeps chunks available for the engine thread, called by the worker */
+    void chunkPoolFill() {
+        while (!chunkPool.full() && chunkReserve()) {
+            chunkPool.push(new float[REMOVE_CHUNK_SIZE]);
+        }
+    }
+
+    /**
+     * Allocates chunks for sequence s to hold length values, returns the number of values available.
+     * Must not be called while the engine thread is processing the module, i.e. on patch loading.
+     */
+    int seqReserve(int s, int length) {
+        while (seqChunks[s] * REMOVE_CHUNK_SIZE < length && seqChunks[s] < REMOVE_MAX_CHUNKS) {
+            float* chunk = NULL;
+            if (chunkPool.size() > 0) {
+                chunk = chunkPool.shift();
+            }
+            else if (chunkReserve()) {
+                chunk = new float[REMOVE_CHUNK_SIZE];
+            }
+            if (!chunk) break;
+            seqData[s][seqChunks[s]++] = chunk;
+        }
+        return std::min(length, seqChunks[s] * REMOVE_CHUNK_SIZE);
+    }
+
+    /** Releases all chunks of all sequences, same restrictions as seqReserve() */
+    void seqFree() {
+        for (int i = 0; i < REMOVE_MAX_SEQ; i++) {
+            for (int k = 0; k < seqChunks[i]; k++) {
+                delete[] seqData[i][k];
+                chunkCount--;
+            }
+            seqChunks[i] = 0;
+        }
+    }
+
+    inline void recPush(RECEVENT type, float value = 0.f, int length = 0) {
+        if (recBuffer.full()) {
+            seqRunsInvalid[seq] = true;
+            return;
+        }
+        recBuffer.push(RecEvent{type, seq, value, length});
+    }
+
+    /** Compacts recorded values and refills the chunk pool, runs on the TaskWorker */
+    void processWorker() {
+        {
+            std::lock_guard<std::mutex> lock(workerMutex);
+            seqRunsProcess();
+        }
+        // Allocations are done without holding the mutex
+        chunkFreeProcess();
+        chunkPoolFill();
+    }
+
+    /** Applies all pending recording events to seqRuns, workerMutex must be held */
+    void seqRunsProcess() {
+        while (recBuffer.size() > 0) {
+            RecEvent e = recBuffer.shift();
+            std::vector<SeqRun>& runs = seqRuns[e.seq];
+            switch (e.type) {
+                case RECEVENT_RESET:
+                    recUndoRuns.swap(runs);
+                    recUndoSeq = e.seq;
+                    recUndoValid = e.length == 0;
+                    runs.clear();
+                    break;
+                case RECEVENT_APPEND:
+                    if (!runs.empty() && runs.back().value == e.value) runs.back().count++;
+                    else runs.push_back(SeqRun{e.value, 1});
+                    break;
+                case RECEVENT_TRIM: {
+                    int c = 0;
+                    size_t k = 0;
+                    while (k < runs.size() && c + runs[k].count <= e.length) { c += runs[k].count; k++; }
+                    if (k < runs.size() && c < e.length) { runs[k].count = e.length - c; k++; }
+                    runs.resize(k);
+                    break;
+                }
+            }
+        }
+    }
+
+    /** Compacts all sequences from seqData again, used when the recorded data has been replaced */
+    void seqRunsRebuild() {
+        std::lock_guard<std::mutex> lock(workerMutex);
+        // Pending events are already contained in seqData
+        while (recBuffer.size() > 0) recBuffer.shift();
+        for (int i = 0; i < REMOVE_MAX_SEQ; i++) {
+            seqRuns[i].clear();
+            seqRunsInvalid[i] = false;
+            if (i >= seqCount) continue;
+            for (int j = 0; j < seqLength[i]; j++) {
+                float v = seqValue(i, j);
+                if (!seqRuns[i].empty() && seqRuns[i].back().value == v) seqRuns[i].back().count++;
+                else seqRuns[i].push_back(SeqRun{v, 1});
+            }
+        }
+    }
+
+    json_t* seqRunsToJson(const std::vector<SeqRun>& runs, int& length) {
+        json_t *seqData1J = json_array();
+        length = 0;
+        size_t n = runs.size();
+        for (size_t k = 0; k < n; k++) {
+            const SeqRun& r = runs[k];
+            json_array_append_new(seqData1J, json_real(r.value));
+            if (r.count >= 2) json_array_append_new(seqData1J, json_real(r.value));
+            // 2 times same value -> number of further repetitions, omitted at the very end
+            if (r.count >= 3 || (r.count == 2 && k + 1 < n)) json_array_append_new(seqData1J, json_integer(r.count - 2));
+            length += r.count;
+        }
+        return seqData1J;
+    }
+
+    json_t* seqDataToJson(int i) {
+        json_t *seqData1J = json_array();
+        float last1 = 100.f, last2 = -100.f;
+        for (int j = 0; j < seqLength[i]; j++) {
+            if (last1 == last2) {
+                // 2 times same value -> compress!
+                int c = 0;
+                while (j < seqLength[i] && seqValue(i, j) == last1) { c++; j++; }
+                json_array_append_new(seqData1J, json_integer(c));
+                if (j < seqLength[i]) {
+                    json_array_append_new(seqData1J, json_real(seqValue(i, j)));
+                    last1 = seqValue(i, j);
+                }
+                last2 = -100.f;
+            } 
+            else {
+                json_array_append_new(seqData1J, json_real(seqValue(i, j)));
+                last2 = last1;
+                last1 = seqValue(i, j);
+            }
+        }
+        return seqData1J;
+    }
+
     void clearMap(int id) override {
         onReset();
         MapModuleBase::clearMap(id);
@@ -630,35 +916,20 @@ struct ReMoveModule : MapModuleBase<1> {
 
         json_t *rec0J = json_object();
 
-        int s = REMOVE_MAX_DATA / seqCount;
         json_t *seqDataJ = json_array();
-        for (int i = 0; i < seqCount; i++) {
-            json_t *seqData1J = json_array();
-            float last1 = 100.f, last2 = -100.f;
-            for (int j = 0; j < seqLength[i]; j++) {
-                if (last1 == last2) {
-                    // 2 times same value -> compress!
-                    int c = 0;
-                    while (seqData[i * s + j] == last1 && j < seqLength[i]) { c++; j++; }
-                    json_array_append_new(seqData1J, json_integer(c));
-                    if (j < seqLength[i]) json_array_append_new(seqData1J, json_real(seqData[i * s + j]));
-                    last2 = -100.f;
-                    last1 = seqData[i * s + j];
-                } 
-                else {
-                    json_array_append_new(seqData1J, json_real(seqData[i * s + j]));
-                    last2 = last1;
-                    last1 = seqData[i * s + j];
-                }
+        json_t *seqLengthJ = json_array();
+        {
+            std::lock_guard<std::mutex> lock(workerMutex);
+            seqRunsProcess();
+            for (int i = 0; i < seqCount; i++) {
+                int length = seqLength[i];
+                // The worker has compacted the data already, unless the record buffer overflowed
+                json_t *seqData1J = seqRunsInvalid[i] ? seqDataToJson(i) : seqRunsToJson(seqRuns[i], length);
+                json_array_append_new(seqDataJ, seqData1J);
+                json_array_append_new(seqLengthJ, json_integer(length));
             }
-            json_array_append_new(seqDataJ, seqData1J);
         }
         json_object_set_new(rec0J, "seqData", seqDataJ);
-
-        json_t *seqLengthJ = json_array();
-        for (int i = 0; i < seqCount; i++) {
-            json_array_append_new(seqLengthJ, json_integer(seqLength[i]));
-        }
         json_object_set_new(rec0J, "seqLength", seqLengthJ);
 
         json_object_set_new(rec0J, "seqCount", json_integer(seqCount));
@@ -673,6 +944,7 @@ struct ReMoveModule : MapModuleBase<1> {
         json_object_set_new(rec0J, "recAutoplay", json_boolean(recAutoplay));
         json_object_set_new(rec0J, "playMode", json_integer(playMode));
         json_object_set_new(rec0J, "sampleRate", json_real(sampleRate));
+        json_object_set_new(rec0J, "seqMaxData", json_integer(seqMaxData));
         json_object_set_new(rec0J, "isPlaying", json_boolean(isPlaying));
 
         json_t *recJ = json_array();
@@ -682,6 +954,28 @@ struct ReMoveModule : MapModuleBase<1> {
         return rootJ;
     }
 
+    /**
+     * Returns the state of the module before the recording of sequence s has been started,
+     * NULL if the replaced sequence is not available anymore. Called by the widget.
+     */
+    json_t* toJsonRecUndo(int s) {
+        json_t* rootJ = toJson();
+        std::lock_guard<std::mutex> lock(workerMutex);
+        bool valid = recUndoSeq == s && recUndoValid;
+        recUndoSeq = -1;
+        json_t* rec0J = json_array_get(json_object_get(json_object_get(rootJ, "data"), "recorder"), 0);
+        json_t* seqDataJ = json_object_get(rec0J, "seqData");
+        json_t* seqLengthJ = json_object_get(rec0J, "seqLength");
+        if (!valid || s >= (int)json_array_size(seqDataJ) || s >= (int)json_array_size(seqLengthJ)) {
+            json_decref(rootJ);
+            return NULL;
+        }
+        int length;
+        json_array_set_new(seqDataJ, s, seqRunsToJson(recUndoRuns, length));
+        json_array_set_new(seqLengthJ, s, json_integer(length));
+        return rootJ;
+    }
+
     void dataFromJson(json_t *rootJ) override {
         MapModuleBase::dataFromJson(rootJ);
         panelTheme = json_integer_value(json_object_get(rootJ, "panelTheme"));
@@ -715,6 +1009,8 @@ struct ReMoveModule : MapModuleBase<1> {
         if (playModeJ) playMode = (PLAYMODE)json_integer_value(playModeJ);
         json_t *sampleRateJ = json_object_get(rec0J, "sampleRate");
         if (sampleRateJ) sampleRate = json_real_value(sampleRateJ);
+        json_t *seqMaxDataJ = json_object_get(rec0J, "seqMaxData");
+        if (seqMaxDataJ) seqMaxData = clamp((int)json_integer_value(seqMaxDataJ), REMOVE_CHUNK_SIZE, REMOVE_MAX_DATA);
         json_t *isPlayingJ = json_object_get(rec0J, "isPlaying");
         if (isPlayingJ) isPlaying = json_boolean_value(isPlayingJ);
 
@@ -728,9 +1024,13 @@ struct ReMoveModule : MapModuleBase<1> {
             }
         }
 
-        int s = REMOVE_MAX_DATA / seqCount;
         json_t *seqDataJ = json_object_get(rec0J, "seqData");
         if (seqDataJ) {
+            seqFree();
+            for (int i = 0; i < REMOVE_MAX_SEQ; i++) {
+                // Sequences are truncated if the data exceeds the memory limit
+                seqLength[i] = i < seqCount ? seqReserve(i, seqLength[i]) : 0;
+            }
             json_t *seqData1J, *d;
             size_t i;
             json_array_foreach(seqDataJ, i, seqData1J) {
@@ -739,17 +1039,17 @@ struct ReMoveModule : MapModuleBase<1> {
                 float last1 = 100.f, last2 = -100.f;
                 int c = 0;
                 json_array_foreach(seqData1J, j, d) {
-                    if (c > seqLength[i]) continue;
+                    if (c >= seqLength[i]) break;
                     if (last1 == last2) {
                         // we've seen two same values -> decompress!
                         int v = json_integer_value(d);
-                        for (int k = 0; k < v; k++) { seqData[i * s + c] = last1; c++; }
+                        for (int k = 0; k < v && c < seqLength[i]; k++) { seqValue(i, c) = last1; c++; }
                         last1 = 100.f; last2 = -100.f;
                     }
                     else {
-                        seqData[i * s + c] = json_real_value(d);
+                        seqValue(i, c) = json_real_value(d);
                         last2 = last1;
-                        last1 = seqData[i * s + c];
+                        last1 = seqValue(i, c);
                         c++;
                     }
                 }
@@ -759,6 +1059,7 @@ struct ReMoveModule : MapModuleBase<1> {
         isRecording = false;
         params[REC_PARAM].setValue(0);
         seqUpdate();
+        seqRunsRebuild();
     }
 
     void onRandomize() override {
@@ -768,11 +1069,13 @@ struct ReMoveModule : MapModuleBase<1> {
         dsp::ExponentialFilter filter;
         filter.setLambda(sampleRate * 10.f);
 
-        int s = REMOVE_MAX_DATA / seqCount;
-        // Generate maximum of 4 seconds random data
-        int l = std::min((int)round(1.f / sampleRate * 8.f), s);
-
         for (int i = 0; i < seqCount; i++) {
+            // Generate maximum of 4 seconds random data
+            int l = seqReserve(i, (int)round(1.f / sampleRate * 8.f));
+            if (l < 8) {
+                seqLength[i] = 0;
+                continue;
+            }
             // Set some start-value for the exponential filter
             filter.out = 0.5f + d(gen) * 10.f;
             float dir = 1.f;
@@ -785,10 +1088,11 @@ struct ReMoveModule : MapModuleBase<1> {
                 p = filter.process(1.f, r >= 0.005f ? p + dir * abs(r) : p);
                 // Only range [0,1] is valid
                 p = clamp(p, 0.f, 1.f);
-                seqData[i * s + c] = p;
+                seqValue(i, c) = p;
             }
             seqLength[i] = l;
         }
+        seqRunsRebuild();
     }
 };
 
@@ -810,12 +1114,12 @@ struct ReMoveDisplay : TransparentWidget {
             nvgClosePath(args.vg);
             nvgStroke(args.vg);
 
-            int seqPos = module->dataPtr - module->seqLow;
+            int seqPos = module->dataPtr;
 
             if (module->isRecording) {
                 // Draw text showing remaining time
                 std::shared_ptr<Font> font = APP->window->loadFont(asset::system("res/fonts/ShareTechMono-Regular.ttf"));
-                float t = ((float)REMOVE_MAX_DATA / (float)module->seqCount - (float)seqPos) * module->sampleRate;
+                float t = (float)module->seqRemaining() * module->sampleRate;
                 nvgFontSize(args.vg, 11);
                 nvgFontFaceId(args.vg, font->handle);
                 nvgTextLetterSpacing(args.vg, -2.2);
@@ -846,7 +1150,7 @@ struct ReMoveDisplay : TransparentWidget {
             int c = std::min(seqLength, 120);
             for (int i = 0; i < c; i++) {
                 float x = (float)i / (c - 1);
-                float y = module->seqData[module->seqLow + (int)floor(x * (seqLength - 1))] * 0.96f + 0.02f;
+                float y = module->seqValue(module->seq, (int)floor(x * (seqLength - 1))) * 0.96f + 0.02f;
                 float px = b.pos.x + b.size.x * x;
                 float py = b.pos.y + b.size.y * (1.0 - y);
                 if (i == 0)
@@ -997,9 +1301,8 @@ struct SampleRateMenuItem : MenuItem {
         }
 
         void step() override {
-            int s1 = REMOVE_MAX_DATA * sampleRate;
-            int s2 = s1 / module->seqCount;
-            rightText = string::f(((module->sampleRate == sampleRate) ? "✔ %ds / %ds" : "%ds / %ds"), s1, s2);
+            int s1 = module->seqMaxData * sampleRate;
+            rightText = string::f(((module->sampleRate == sampleRate) ? "✔ %ds" : "%ds"), s1);
             MenuItem::step();
         }
     };
@@ -1020,6 +1323,34 @@ struct SampleRateMenuItem : MenuItem {
 };
 
 
+struct MemoryLimitMenuItem : MenuItem {
+    struct MemoryLimitItem : MenuItem {
+        ReMoveModule *module;
+        int seqMaxData;
+
+        void onAction(const event::Action &e) override {
+            module->seqMaxData = seqMaxData;
+            module->chunkTrim = true;
+        }
+
+        void step() override {
+            rightText = module->seqMaxData == seqMaxData ? "✔" : "";
+            MenuItem::step();
+        }
+    };
+    
+    ReMoveModule *module;
+    Menu *createChildMenu() override {
+        Menu *menu = new Menu;
+        menu->addChild(construct<MemoryLimitItem>(&MenuItem::text, "256kB", &MemoryLimitItem::module, module, &MemoryLimitItem::seqMaxData, 64 * 1024));
+        menu->addChild(construct<MemoryLimitItem>(&MenuItem::text, "1MB", &MemoryLimitItem::module, module, &MemoryLimitItem::seqMaxData, 256 * 1024));
+        menu->addChild(construct<MemoryLimitItem>(&MenuItem::text, "4MB", &MemoryLimitItem::module, module, &MemoryLimitItem::seqMaxData, 1024 * 1024));
+        menu->addChild(construct<MemoryLimitItem>(&MenuItem::text, "16MB", &MemoryLimitItem::module, module, &MemoryLimitItem::seqMaxData, REMOVE_MAX_DATA));
+        return menu;
+    }
+};
+
+
 struct SeqCountMenuItem : MenuItem {
     struct SeqCountItem : MenuItem {
         ReMoveModule *module;
@@ -1249,6 +1580,50 @@ struct ReMoveWidget : ThemedModuleWidget<ReMoveModule> {
         addChild(display); 
     }
 
+    /** last dragged widget to avoid frequent dynamic casting */
+    Widget* lastDraggedWidget = NULL;
+    bool lastDraggedParam = false;
+    /** history-item of the current recording */
+    history::ModuleChange* recChangeHistory = NULL;
+
+    ~ReMoveWidget() {
+        delete recChangeHistory;
+    }
+
+    void step() override {
+        if (module) {
+            // Undo history of recordings, the engine thread only reports starts and stops
+            while (module->recHistory.size() > 0) {
+                RecHistoryEvent e = module->recHistory.shift();
+                if (e.type == RECHISTORY_START) {
+                    delete recChangeHistory;
+                    recChangeHistory = NULL;
+                    json_t* oldModuleJ = module->toJsonRecUndo(e.seq);
+                    if (!oldModuleJ) continue;
+                    recChangeHistory = new history::ModuleChange;
+                    recChangeHistory->name = "ReMOVE recording";
+                    recChangeHistory->moduleId = module->id;
+                    recChangeHistory->oldModuleJ = oldModuleJ;
+                }
+                else if (recChangeHistory) {
+                    recChangeHistory->newModuleJ = module->toJson();
+                    APP->history->push(recChangeHistory);
+                    recChangeHistory = NULL;
+                }
+            }
+
+            // Touch detection for recording, the engine thread must not access the event state
+            Widget* w = APP->event->getDraggedWidget();
+            if (w != lastDraggedWidget) {
+                lastDraggedWidget = w;
+                ParamWidget* pw = dynamic_cast<ParamWidget*>(w);
+                lastDraggedParam = pw != NULL && pw->getParamQuantity() == module->getParamQuantity(0);
+            }
+            module->dragState = w == NULL ? DRAGSTATE_NONE : (lastDraggedParam ? DRAGSTATE_PARAM : DRAGSTATE_OTHER);
+        }
+        ThemedModuleWidget<ReMoveModule>::step();
+    }
+
     void appendContextMenu(Menu *menu) override {
         ThemedModuleWidget<ReMoveModule>::appendContextMenu(menu);
         ReMoveModule *module = dynamic_cast<ReMoveModule*>(this->module);
@@ -1263,6 +1638,10 @@ struct ReMoveWidget : ThemedModuleWidget<ReMoveModule> {
         sampleRateMenuItem->rightText = RIGHT_ARROW;
         menu->addChild(sampleRateMenuItem);
 
+        MemoryLimitMenuItem *memoryLimitMenuItem = construct<MemoryLimitMenuItem>(&MenuItem::text, "Memory limit", &MemoryLimitMenuItem::module, module);
+        memoryLimitMenuItem->rightText = RIGHT_ARROW;
+        menu->addChild(memoryLimitMenuItem);
+
         SeqCountMenuItem *seqCountMenuItem = construct<SeqCountMenuItem>(&MenuItem::text, "# of sequences", &SeqCountMenuItem::module, module);
         seqCountMenuItem->rightText = RIGHT_ARROW;
         menu->addChild(seqCountMenuItem);
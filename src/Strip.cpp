@@ -79,6 +79,7 @@ struct StripModule : StripModuleBase {
 		configParam(EXCLUDE_PARAM, 0, 1, 0, "Parameter randomization include/exclude");
 
 		lightDivider.setDivision(1024);
+		taskWorker.postHandler = [this](int v) { groupDisableWorker(v & 1, v & 2); };
 		onReset();
 	}
 
@@ -92,6 +93,8 @@ struct StripModule : StripModuleBase {
 	}
 
 	void process(const ProcessArgs& args) override {
+		taskWorker.postPoll();
+
 		if (modeTrigger.process(params[MODE_PARAM].getValue())) {
 			mode = (MODE)(((int)mode + 1) % 3);
 			lastState = true;
@@ -130,7 +133,7 @@ struct StripModule : StripModuleBase {
 	}
 
 	void groupDisable(bool val, bool useHistory) {
-		taskWorker.work([=]() { groupDisableWorker(val, useHistory); });
+		taskWorker.post((val ? 1 : 0) | (useHistory ? 2 : 0));
 	}
 
 	/** 
@@ -723,12 +726,12 @@ struct StripWidget : StripWidgetBase<StripModule> {
 
 		menu->addChild(construct<MenuLabel>(&MenuLabel::text, "Strip"));
 		menu->addChild(construct<PresetMenuItem>(&MenuItem::text, "Preset", &PresetMenuItem::module, module, &PresetMenuItem::mw, this));
-		menu->addChild(construct<CutGroupMenuItem>(&MenuItem::text, "Cut", &MenuItem::rightText, RACK_MOD_SHIFT_NAME "+X", &CutGroupMenuItem::moduleWidget, this));
-		menu->addChild(construct<CopyGroupMenuItem>(&MenuItem::text, "Copy", &MenuItem::rightText, RACK_MOD_SHIFT_NAME "+C", &CopyGroupMenuItem::moduleWidget, this));
-		menu->addChild(construct<PasteGroupMenuItem>(&MenuItem::text, "Paste", &MenuItem::rightText, RACK_MOD_SHIFT_NAME "+V", &PasteGroupMenuItem::moduleWidget, this));
-		menu->addChild(construct<LoadGroupMenuItem>(&MenuItem::text, "Load", &MenuItem::rightText, RACK_MOD_SHIFT_NAME "+L", &LoadGroupMenuItem::moduleWidget, this));
-		menu->addChild(construct<LoadReplaceGroupMenuItem>(&MenuItem::text, "Load with replace", &MenuItem::rightText, RACK_MOD_CTRL_NAME "+" RACK_MOD_SHIFT_NAME "+L", &LoadReplaceGroupMenuItem::moduleWidget, this));
-		menu->addChild(construct<SaveGroupMenuItem>(&MenuItem::text, "Save as", &MenuItem::rightText, RACK_MOD_SHIFT_NAME "+S", &SaveGroupMenuItem::moduleWidget, this));
+		menu->addChild(construct<CutGroupMenuItem>(&MenuItem::text, "Cut", &MenuItem::disabled, groupLoader != NULL, &MenuItem::rightText, RACK_MOD_SHIFT_NAME "+X", &CutGroupMenuItem::moduleWidget, this));
+		menu->addChild(construct<CopyGroupMenuItem>(&MenuItem::text, "Copy", &MenuItem::disabled, groupLoader != NULL, &MenuItem::rightText, RACK_MOD_SHIFT_NAME "+C", &CopyGroupMenuItem::moduleWidget, this));
+		menu->addChild(construct<PasteGroupMenuItem>(&MenuItem::text, "Paste", &MenuItem::disabled, groupLoader != NULL, &MenuItem::rightText, RACK_MOD_SHIFT_NAME "+V", &PasteGroupMenuItem::moduleWidget, this));
+		menu->addChild(construct<LoadGroupMenuItem>(&MenuItem::text, "Load", &MenuItem::disabled, groupLoader != NULL, &MenuItem::rightText, RACK_MOD_SHIFT_NAME "+L", &LoadGroupMenuItem::moduleWidget, this));
+		menu->addChild(construct<LoadReplaceGroupMenuItem>(&MenuItem::text, "Load with replace", &MenuItem::disabled, groupLoader != NULL, &MenuItem::rightText, RACK_MOD_CTRL_NAME "+" RACK_MOD_SHIFT_NAME "+L", &LoadReplaceGroupMenuItem::moduleWidget, this));
+		menu->addChild(construct<SaveGroupMenuItem>(&MenuItem::text, "Save as", &MenuItem::disabled, groupLoader != NULL, &MenuItem::rightText, RACK_MOD_SHIFT_NAME "+S", &SaveGroupMenuItem::moduleWidget, this));
 	}
 };
 
@@ -1,6 +1,8 @@
 #pragma once
 #include "plugin.hpp"
 #include "helpers/StripIdFixModule.hpp"
+#include "helpers/TaskWorker.hpp"
+#include "ui/OverlayMessageWidget.hpp"
 #include <osdialog.h>
 #include <plugin.hpp>
 
@@ -9,6 +11,8 @@ namespace Strip {
 
 static const char PRESET_FILTERS[] = "stoermelder STRIP group preset (.vcvss):vcvss";
 static const char SELECTION_FILTERS[] = "VCV Rack module selection (.vcvs):vcvs";
+/** Time in seconds per frame used for loading a group */
+static const double GROUP_LOAD_BUDGET = 0.01;
 
 enum class MODE {
 	LEFTRIGHT = 0,
@@ -41,7 +45,7 @@ struct StripBayBase : Module {
 
 
 template <class MODULE>
-struct StripWidgetBase : ThemedModuleWidget<MODULE> {
+struct StripWidgetBase : ThemedModuleWidget<MODULE>, OverlayMessageProvider {
 	typedef ThemedModuleWidget<MODULE> BASE;
 	MODULE* module;
 	std::string warningLog;
@@ -49,6 +53,15 @@ struct StripWidgetBase : ThemedModuleWidget<MODULE> {
 	StripWidgetBase(MODULE* module, std::string baseName)
 	: ThemedModuleWidget<MODULE>(module, baseName) { }
 
+	~StripWidgetBase() {
+		if (groupLoader) groupLoadEnd();
+	}
+
+	void step() override {
+		BASE::step();
+		if (groupLoader) groupLoadStep();
+	}
+
 	/**
 	 * Removes all modules in the group. Used for "cut" in cut & paste.
 	 */
@@ -194,7 +207,17 @@ struct StripWidgetBase : ThemedModuleWidget<MODULE> {
 		return undoActions;
 	}
 
-	void groupConnectionsCollect(std::list<std::tuple<std::string, int, PortWidget*, NVGcolor>>& conn) {
+	/** Cable of a StripCon module to a port outside the strip, kept by ids as widgets could be removed meanwhile */
+	struct GroupConnection {
+		std::string connId;
+		int portId;
+		int64_t otherModuleId;
+		int otherPortId;
+		engine::Port::Type otherType;
+		NVGcolor color;
+	};
+
+	void groupConnectionsCollect(std::list<GroupConnection>& conn) {
 		std::list<StripBayBase*> toDo;
 		std::set<int64_t> moduleIds;
 
@@ -228,7 +251,7 @@ struct StripWidgetBase : ThemedModuleWidget<MODULE> {
 				auto it = moduleIds.find(c->outputPort->module->id);
 				// Other end is outside of this strip
 				if (it == moduleIds.end()) {
-					conn.push_back(std::make_tuple(sc->getConnId(), c->inputPort->portId, c->outputPort, c->color));
+					conn.push_back(GroupConnection{sc->getConnId(), c->inputPort->portId, c->outputPort->module->id, c->outputPort->portId, engine::Port::OUTPUT, c->color});
 				}
 			}
 			for (PortWidget* out : mw->getOutputs()) {
@@ -237,14 +260,14 @@ struct StripWidgetBase : ThemedModuleWidget<MODULE> {
 					auto it = moduleIds.find(c->inputPort->module->id);
 					// Other end is outside of this strip
 					if (it == moduleIds.end()) {
-						conn.push_back(std::make_tuple(sc->getConnId(), c->outputPort->portId, c->inputPort, c->color));
+						conn.push_back(GroupConnection{sc->getConnId(), c->outputPort->portId, c->inputPort->module->id, c->inputPort->portId, engine::Port::INPUT, c->color});
 					}
 				}
 			}
 		}
 	}
 
-	std::vector<history::Action*>* groupConnectionsRestore(std::list<std::tuple<std::string, int, PortWidget*, NVGcolor>>& conn) {
+	std::vector<history::Action*>* groupConnectionsRestore(std::list<GroupConnection>& conn) {
 		std::vector<history::Action*>* undoActions = new std::vector<history::Action*>;
 		std::map<std::string, StripBayBase*> toDo;
 
@@ -268,12 +291,15 @@ struct StripWidgetBase : ThemedModuleWidget<MODULE> {
 			}
 		}
 
-		for (auto t : conn) {
-			std::string connId = std::get<0>(t);
-			int portId = std::get<1>(t);
-			PortWidget* pw1 = std::get<2>(t);
-			NVGcolor color = std::get<3>(t);
-			assert(pw1);
+		for (GroupConnection& t : conn) {
+			std::string connId = t.connId;
+			int portId = t.portId;
+			NVGcolor color = t.color;
+			// The module on the other end could have been removed in the meantime
+			ModuleWidget* mw1 = APP->scene->rack->getModule(t.otherModuleId);
+			if (!mw1) continue;
+			PortWidget* pw1 = t.otherType == engine::Port::INPUT ? mw1->getInput(t.otherPortId) : mw1->getOutput(t.otherPortId);
+			if (!pw1) continue;
 
 			auto it = toDo.find(connId);
 			if (it == toDo.end()) continue;
@@ -397,62 +423,31 @@ struct StripWidgetBase : ThemedModuleWidget<MODULE> {
 	}
 
 	/**
-	 * Adds modules next to this module according to the supplied json-representation.
-	 * @rootJ json-representation of the STRIP-file
+	 * Adds a single module of a group next to this module.
+	 * @moduleJ json-representation of the module
+	 * @modPos Should the module placed left or right of @box?
+	 * @box box of the module previously added on the same side
 	 * @modules maps old module ids the new modules
+	 * @oldId returns the old id of the module
 	 */
-	std::vector<history::Action*>* groupFromJson_modules(json_t* rootJ, std::map<int64_t, ModuleWidget*>& modules) {
-		std::vector<history::Action*>* undoActions = new std::vector<history::Action*>;
-
-		if (module->mode == MODE::LEFTRIGHT || module->mode == MODE::RIGHT) {
-			Rect box = this->box;
-			json_t* rightModulesJ = json_object_get(rootJ, "rightModules");
-			if (rightModulesJ) {
-				json_t* moduleJ;
-				size_t moduleIndex;
-				json_array_foreach(rightModulesJ, moduleIndex, moduleJ) {
-					int64_t oldId = -1;
-					box.pos = box.pos.plus(Vec(box.size.x, 0));
-					ModuleWidget* mw = moduleToRack(moduleJ, moduleToRackPos::RIGHT, box, oldId);
-					// mw could be NULL, just move on
-					modules[oldId] = mw;
-
-					if (mw) {
-						// ModuleAdd history action
-						history::ModuleAdd* h = new history::ModuleAdd;
-						h->name = "create module";
-						h->setModule(mw);
-						undoActions->push_back(h);
-					}
-				}
-			}
-		}
-		if (module->mode == MODE::LEFTRIGHT || module->mode == MODE::LEFT) {
-			Rect box = this->box;
-			json_t* leftModulesJ = json_object_get(rootJ, "leftModules");
-			if (leftModulesJ) {
-				json_t* moduleJ;
-				size_t moduleIndex;
-				json_array_foreach(leftModulesJ, moduleIndex, moduleJ) {
-					int64_t oldId = -1;
-					ModuleWidget* mw = moduleToRack(moduleJ, moduleToRackPos::LEFT, box, oldId);
-					modules[oldId] = mw;
-
-					if (mw) {
-						// ModuleAdd history action
-						history::ModuleAdd* h = new history::ModuleAdd;
-						h->name = "create module";
-						h->setModule(mw);
-						undoActions->push_back(h);
-					}
-				}
-			}
+	history::Action* groupFromJson_module(json_t* moduleJ, moduleToRackPos modPos, Rect& box, StripIdFixMap& modules, int64_t& oldId) {
+		oldId = -1;
+		if (modPos == moduleToRackPos::RIGHT) {
+			box.pos = box.pos.plus(Vec(box.size.x, 0));
 		}
-
-		return undoActions;
+		ModuleWidget* mw = moduleToRack(moduleJ, modPos, box, oldId);
+		// mw could be NULL, just move on
+		modules[oldId] = mw;
+		if (!mw) return NULL;
+
+		// ModuleAdd history action
+		history::ModuleAdd* h = new history::ModuleAdd;
+		h->name = "create module";
+		h->setModule(mw);
+		return h;
 	}
 
-	std::vector<history::Action*>* groupSelectionFromJson_modules(json_t* rootJ, std::map<int64_t, ModuleWidget*>& modules) {
+	std::vector<history::Action*>* groupSelectionFromJson_modules(json_t* rootJ, StripIdFixMap& modules) {
 		std::vector<history::Action*>* undoActions = new std::vector<history::Action*>;
 
 		Vec mousePos = APP->scene->rack->getMousePos();
@@ -503,141 +498,114 @@ struct StripWidgetBase : ThemedModuleWidget<MODULE> {
 		return undoActions;
 	}
 
+	/**
+	 * Locations of module ids within the json-representation of modules known to use
+	 * mapping of parameters. Each path is walked from the module's json-object, "*"
+	 * iterates over an array. Modules of PackOne using mappings (MIDI-CAT, CV-MAP,
+	 * TRANSIT, 8FACE mk2, ...) fix their ids on their own using StripIdFixModule.
+	 */
+	static const std::unordered_map<std::string, std::vector<std::vector<const char*>>>& idFixPaths() {
+		static const std::unordered_map<std::string, std::vector<std::vector<const char*>>> paths = {
+			{ "Core/MIDI-Map", { { "data", "maps", "*", "moduleId" } } },
+			{ "MindMeldModular/PatchMaster", { { "data", "maps", "*", "moduleId" } } },
+			// The snapshots of 8FACE mk2 contain complete module json-representations
+			{ "Stoermelder-P1/EightFaceMk2", { { "data", "presets", "*", "slot", "*", "id" } } },
+			{ "Stoermelder-P1/EightFaceMk2Ex", { { "data", "presets", "*", "slot", "*", "id" } } }
+		};
+		return paths;
+	}
+
+	/**
+	 * Replaces the module id found at @path within @j by the id of the new module.
+	 */
+	void groupFromJson_presets_fixId(json_t* j, const std::vector<const char*>& path, size_t i, const StripIdFixMap& modules) {
+		if (!j) return;
+		const char* key = path[i];
+		if (i + 1 < path.size()) {
+			if (std::strcmp(key, "*") == 0) {
+				json_t* vJ;
+				size_t vIndex;
+				json_array_foreach(j, vIndex, vJ) {
+					groupFromJson_presets_fixId(vJ, path, i + 1, modules);
+				}
+			}
+			else {
+				groupFromJson_presets_fixId(json_object_get(j, key), path, i + 1, modules);
+			}
+			return;
+		}
+
+		json_t* moduleIdJ = json_object_get(j, key);
+		if (!moduleIdJ) return;
+		int64_t oldId = json_integer_value(moduleIdJ);
+		if (oldId < 0) return;
+		int64_t newId = -1;
+		auto it = modules.find(oldId);
+		if (it != modules.end() && it->second != NULL) {
+			newId = it->second->module->id;
+		}
+		json_object_set_new(j, key, json_integer(newId));
+	}
+
 	/**
 	 * Fixes parameter mappings within a preset. This can be considered a hack because
 	 * Rack v1/v2 offers no API for reading the mapping module of a parameter. This replaces the
 	 * module id in the preset JSON with the new module id to preserve correct mapping.
-	 * This means every module using mappings must be handled explicitly.
+	 * This means every module using mappings must be handled explicitly, see idFixPaths().
 	 * @moduleJ json-representation of the module
 	 * @modules maps old module ids the new modules
 	 */
-	void groupFromJson_presets_fixMapping(json_t* moduleJ, std::map<int64_t, ModuleWidget*>& modules) {
-		std::string pluginSlug = json_string_value(json_object_get(moduleJ, "plugin"));
-		std::string modelSlug = json_string_value(json_object_get(moduleJ, "model"));
-
-		static const std::set<std::tuple<std::string, std::string>> moduleSlugs = {
-			std::make_tuple("Core", "MIDI-Map"),
-			std::make_tuple("MindMeldModular", "PatchMaster")
-		};
+	void groupFromJson_presets_fixMapping(json_t* moduleJ, const StripIdFixMap& modules) {
+		const char* pluginSlug = json_string_value(json_object_get(moduleJ, "plugin"));
+		const char* modelSlug = json_string_value(json_object_get(moduleJ, "model"));
+		if (!pluginSlug || !modelSlug) return;
 
 		// Only handle some specific modules known to use mapping of parameters
-		if (moduleSlugs.find(std::make_tuple(pluginSlug, modelSlug)) == moduleSlugs.end())
-			return;
+		auto it = idFixPaths().find(std::string(pluginSlug) + "/" + modelSlug);
+		if (it == idFixPaths().end()) return;
 
-		json_t* dataJ = json_object_get(moduleJ, "data");
-		json_t* mapsJ = json_object_get(dataJ, "maps");
-		if (mapsJ) {
-			json_t* mapJ;
-			size_t mapIndex;
-			json_array_foreach(mapsJ, mapIndex, mapJ) {
-				json_t* moduleIdJ = json_object_get(mapJ, "moduleId");
-				if (!moduleIdJ)
-					continue;
-				int64_t oldId = json_integer_value(moduleIdJ);
-				if (oldId >= 0) {
-					int64_t newId = -1;
-					ModuleWidget* mw = modules[oldId];
-					if (mw != NULL) {
-						newId = mw->module->id;
-					}
-					json_object_set_new(mapJ, "moduleId", json_integer(newId));
-				}
-			}
+		for (const std::vector<const char*>& path : it->second) {
+			groupFromJson_presets_fixId(moduleJ, path, 0, modules);
 		}
 	}
 
 	/**
-	 * Loads all the presets from a json-representation generated by STRIP. Assumes the modules are there.
-	 * Presets of non-existing modules will be skipped.
-	 * @json json-representation of the STRIP-file
+	 * Loads the preset of a single module from a json-representation generated by STRIP.
+	 * Assumes the module is there, presets of non-existing modules will be skipped.
+	 * @moduleJ json-representation of the module
 	 * @modules maps old module ids the new modules
 	 */
-	std::vector<history::Action*>* groupFromJson_presets(json_t* rootJ, std::map<int64_t, ModuleWidget*>& modules) {
-		std::vector<history::Action*>* undoActions = new std::vector<history::Action*>;
-
-		json_t* rightModulesJ = json_object_get(rootJ, "rightModules");
-		if (rightModulesJ) {
-			json_t* moduleJ;
-			size_t moduleIndex;
-			json_array_foreach(rightModulesJ, moduleIndex, moduleJ) {
-				if (module->mode == MODE::LEFTRIGHT || module->mode == MODE::RIGHT) {
-					groupFromJson_presets_fixMapping(moduleJ, modules);
-					int64_t oldId = json_integer_value(json_object_get(moduleJ, "id"));
-					ModuleWidget* mw = modules[oldId];
-					if (mw != NULL) {
-						// history::ModuleChange
-						history::ModuleChange* h = new history::ModuleChange;
-						h->name = "load module preset";
-						h->moduleId = mw->module->id;
-						h->oldModuleJ = mw->toJson();
-
-						StripIdFixModule* m = dynamic_cast<StripIdFixModule*>(mw->module);
-						if (m) m->idFixDataFromJson(modules);
-
-						mw->fromJson(moduleJ);
-
-						h->newModuleJ = mw->toJson();
-						undoActions->push_back(h);
-					}
-				}
-			}
-		}
-		json_t* leftModulesJ = json_object_get(rootJ, "leftModules");
-		if (leftModulesJ) {
-			json_t* moduleJ;
-			size_t moduleIndex;
-			json_array_foreach(leftModulesJ, moduleIndex, moduleJ) {
-				if (module->mode == MODE::LEFTRIGHT || module->mode == MODE::LEFT) {
-					groupFromJson_presets_fixMapping(moduleJ, modules);
-					int64_t oldId = json_integer_value(json_object_get(moduleJ, "id"));
-					ModuleWidget* mw = modules[oldId];
-					if (mw != NULL) {
-						// history::ModuleChange
-						history::ModuleChange* h = new history::ModuleChange;
-						h->name = "load module preset";
-						h->moduleId = mw->module->id;
-						h->oldModuleJ = mw->toJson();
-
-						StripIdFixModule* m = dynamic_cast<StripIdFixModule*>(mw->module);
-						if (m) m->idFixDataFromJson(modules);
-
-						mw->fromJson(moduleJ);
-
-						h->newModuleJ = mw->toJson();
-						undoActions->push_back(h);
-					}
-				}
-			}
-		}
-
-		return undoActions;
+	history::Action* groupFromJson_preset(json_t* moduleJ, StripIdFixMap& modules) {
+		groupFromJson_presets_fixMapping(moduleJ, modules);
+		int64_t oldId = json_integer_value(json_object_get(moduleJ, "id"));
+		auto it = modules.find(oldId);
+		if (it == modules.end() || it->second == NULL) return NULL;
+		ModuleWidget* mw = it->second;
+
+		// history::ModuleChange
+		history::ModuleChange* h = new history::ModuleChange;
+		h->name = "load module preset";
+		h->moduleId = mw->module->id;
+		h->oldModuleJ = mw->toJson();
+
+		StripIdFixModule* m = dynamic_cast<StripIdFixModule*>(mw->module);
+		if (m) m->idFixDataFromJson(modules);
+
+		mw->fromJson(moduleJ);
+
+		h->newModuleJ = mw->toJson();
+		return h;
 	}
 
-	std::vector<history::Action*>* groupSelectionFromJson_presets(json_t* rootJ, std::map<int64_t, ModuleWidget*>& modules) {
+	std::vector<history::Action*>* groupSelectionFromJson_presets(json_t* rootJ, StripIdFixMap& modules) {
 		std::vector<history::Action*>* undoActions = new std::vector<history::Action*>;
 
 		json_t* modulesJ = json_object_get(rootJ, "modules");
 		json_t* moduleJ;
 		size_t moduleIndex;
 		json_array_foreach(modulesJ, moduleIndex, moduleJ) {
-			groupFromJson_presets_fixMapping(moduleJ, modules);
-			int64_t oldId = json_integer_value(json_object_get(moduleJ, "id"));
-			ModuleWidget* mw = modules[oldId];
-			if (mw != NULL) {
-				// history::ModuleChange
-				history::ModuleChange* h = new history::ModuleChange;
-				h->name = "load module preset";
-				h->moduleId = mw->module->id;
-				h->oldModuleJ = mw->toJson();
-
-				StripIdFixModule* m = dynamic_cast<StripIdFixModule*>(mw->module);
-				if (m) m->idFixDataFromJson(modules);
-
-				mw->fromJson(moduleJ);
-
-				h->newModuleJ = mw->toJson();
-				undoActions->push_back(h);
-			}
+			history::Action* h = groupFromJson_preset(moduleJ, modules);
+			if (h) undoActions->push_back(h);
 		}
 
 		return undoActions;
@@ -649,7 +617,7 @@ struct StripWidgetBase : ThemedModuleWidget<MODULE> {
 	 * @rootJ json-representation of the STRIP-file
 	 * @modules maps old module ids the new modules
 	 */
-	std::vector<history::Action*>* groupFromJson_cables(json_t* rootJ, std::map<int64_t, ModuleWidget*>& modules) {
+	std::vector<history::Action*>* groupFromJson_cables(json_t* rootJ, StripIdFixMap& modules) {
 		std::vector<history::Action*>* undoActions = new std::vector<history::Action*>;
 
 		json_t* cablesJ = json_object_get(rootJ, "cables");
@@ -663,9 +631,12 @@ struct StripWidgetBase : ThemedModuleWidget<MODULE> {
 				int inputId = json_integer_value(json_object_get(cableJ, "inputId"));
 				const char* colorStr = json_string_value(json_object_get(cableJ, "color"));
 
-				ModuleWidget* outputModule = modules[outputModuleId];
-				ModuleWidget* inputModule = modules[inputModuleId];
+				auto outputIt = modules.find(outputModuleId);
+				auto inputIt = modules.find(inputModuleId);
 				// In case one of the modules could not be loaded
+				if (outputIt == modules.end() || inputIt == modules.end()) continue;
+				ModuleWidget* outputModule = outputIt->second;
+				ModuleWidget* inputModule = inputIt->second;
 				if (!outputModule || !inputModule) continue;
 
 				engine::Cable* c = new engine::Cable;
@@ -771,6 +742,7 @@ struct StripWidgetBase : ThemedModuleWidget<MODULE> {
 	}
 
 	void groupCopyClipboard() {
+		if (groupLoader) return;
 		json_t* rootJ = json_object();
 		groupToJson(rootJ);
 
@@ -785,6 +757,7 @@ struct StripWidgetBase : ThemedModuleWidget<MODULE> {
 	}
 
 	void groupCutClipboard() {
+		if (groupLoader) return;
 		json_t* rootJ = json_object();
 		groupToJson(rootJ);
 
@@ -822,6 +795,7 @@ struct StripWidgetBase : ThemedModuleWidget<MODULE> {
 	}
 
 	void groupSaveFileDialog() {
+		if (groupLoader) return;
 		osdialog_filters* filters = osdialog_filters_parse(PRESET_FILTERS);
 		DEFER({
 			osdialog_filters_free(filters);
@@ -846,94 +820,246 @@ struct StripWidgetBase : ThemedModuleWidget<MODULE> {
 		groupSaveFile(pathStr);
 	}
 
-	void groupFromJson(json_t* rootJ) {
-		warningLog = "";
+	/**
+	 * State of a group which is loaded over several frames. Modules are added and
+	 * their presets loaded in batches to keep the UI responsive.
+	 */
+	struct GroupLoader {
+		enum class STAGE {
+			PARSE,
+			CLEAR,
+			MODULES,
+			PRESETS,
+			CABLES
+		};
 
-		// Clear modules next to STRIP
-		std::vector<history::Action*>* h1 = groupClearSpace(rootJ);
+		STAGE stage = STAGE::PARSE;
+		bool replace;
+		std::string name;
+		/** Set by the worker thread, valid after @parseResult is ready */
+		json_t* rootJ = NULL;
+		std::string parseError;
+		std::future<void> parseResult;
+
+		/** Modules of the group in order they are added to the rack */
+		std::vector<std::tuple<json_t*, moduleToRackPos>> moduleJs;
+		size_t moduleIndex = 0;
+		Rect boxRight;
+		Rect boxLeft;
+		/** Maps old moduleId to the id of the newly created module, -1 if it could not be created */
+		std::unordered_map<int64_t, int64_t> moduleIds;
+		/** Newly created modules resolved from @moduleIds, valid for the current frame only */
+		StripIdFixMap modules;
+		/** Connections outside the strip using StripCon modules, only used on replace */
+		std::list<GroupConnection> conn;
+		history::ComplexAction* complexAction = NULL;
+	};
 
-		// Maps old moduleId to the newly created modules (with new id)
-		std::map<int64_t, ModuleWidget*> modules;
-		// Add modules
-		std::vector<history::Action*>* h2 = groupFromJson_modules(rootJ, modules);
-		// Load presets for modules, also fixes parameter mappings
-		std::vector<history::Action*>* h3 = groupFromJson_presets(rootJ, modules);
+	GroupLoader* groupLoader = NULL;
+	bool groupLoaderMessage = false;
+	TaskWorker groupLoaderWorker;
 
-		// Add cables
-		std::vector<history::Action*>* h4 = groupFromJson_cables(rootJ, modules);
+	/**
+	 * Starts loading a group, @parse is called on a worker thread and returns the
+	 * json-representation of the STRIP-file or NULL and an error message.
+	 */
+	void groupLoadStart(std::string name, bool replace, std::function<json_t*(std::string&)> parse) {
+		if (groupLoader) return;
+		GroupLoader* l = new GroupLoader;
+		l->replace = replace;
+		l->name = name;
+		l->parseResult = groupLoaderWorker.work([=]() {
+			json_t* rootJ = parse(l->parseError);
+			if (rootJ && !json_is_object(rootJ)) {
+				json_decref(rootJ);
+				rootJ = NULL;
+				l->parseError = "File is not a valid STRIP file.";
+			}
+			l->rootJ = rootJ;
+		});
+		groupLoader = l;
+		OverlayMessageWidget::registerProvider(this);
+	}
 
-		// Does nothing, but fixes https://github.com/VCVRack/Rack/issues/1444 for Rack <= 1.1.1
-		APP->scene->rack->requestModulePos(this, this->box.pos);
+	void groupLoadEnd() {
+		GroupLoader* l = groupLoader;
+		if (l->parseResult.valid()) l->parseResult.wait();
+		if (l->rootJ) json_decref(l->rootJ);
+		if (l->complexAction) delete l->complexAction;
+		delete l;
+		groupLoader = NULL;
+		OverlayMessageWidget::unregisterProvider(this);
+	}
 
-		if (!warningLog.empty()) {
-			osdialog_message(OSDIALOG_WARNING, OSDIALOG_OK, warningLog.c_str());
+	/**
+	 * Processes the current group being loaded until the time budget of this frame is used.
+	 */
+	void groupLoadStep() {
+		double t = system::getTime() + GROUP_LOAD_BUDGET;
+		groupLoaderMessage = true;
+		// Modules could have been removed since the last frame, resolve them again
+		GroupLoader* l = groupLoader;
+		l->modules.clear();
+		for (auto it : l->moduleIds) {
+			l->modules[it.first] = it.second >= 0 ? APP->scene->rack->getModule(it.second) : NULL;
+		}
+		while (groupLoader && system::getTime() < t) {
+			if (!groupLoadProcess()) break;
 		}
-
-		history::ComplexAction* complexAction = new history::ComplexAction;
-		complexAction->name = "stoermelder STRIP load";
-		for (history::Action* h : *h1) complexAction->push(h);
-		delete h1;
-		for (history::Action* h : *h2) complexAction->push(h);
-		delete h2;
-		for (history::Action* h : *h3) complexAction->push(h);
-		delete h3;
-		for (history::Action* h : *h4) complexAction->push(h);
-		delete h4;
-		APP->history->push(complexAction);
 	}
 
-	void groupSelectionFromJson(json_t* rootJ) {
-		warningLog = "";
+	/**
+	 * Runs a single step of loading a group, returns false if nothing can be done in this frame.
+	 */
+	bool groupLoadProcess() {
+		GroupLoader* l = groupLoader;
+		switch (l->stage) {
+			case GroupLoader::STAGE::PARSE: {
+				if (l->parseResult.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return false;
+				l->parseResult.get();
+				if (!l->rootJ) {
+					std::string message = l->parseError;
+					groupLoadEnd();
+					osdialog_message(OSDIALOG_WARNING, OSDIALOG_OK, message.c_str());
+					return false;
+				}
+				l->stage = GroupLoader::STAGE::CLEAR;
+				return true;
+			}
 
-		// Maps old moduleId to the newly created modules (with new id)
-		std::map<int64_t, ModuleWidget*> modules;
-		// Add modules
-		std::vector<history::Action*>* h2 = groupSelectionFromJson_modules(rootJ, modules);
-		// Load presets for modules, also fixes parameter mappings
-		std::vector<history::Action*>* h3 = groupSelectionFromJson_presets(rootJ, modules);
+			case GroupLoader::STAGE::CLEAR: {
+				warningLog = "";
+				l->complexAction = new history::ComplexAction;
+				l->complexAction->name = "stoermelder STRIP load";
 
-		// Add cables
-		std::vector<history::Action*>* h4 = groupFromJson_cables(rootJ, modules);
+				if (l->replace) {
+					// Collect all connections outside the strip using StripCon modules
+					groupConnectionsCollect(l->conn);
+					// Remove all modules adjacent to STRIP
+					groupRemove();
+				}
 
-		// Does nothing, but fixes https://github.com/VCVRack/Rack/issues/1444 for Rack <= 1.1.1
-		APP->scene->rack->requestModulePos(this, this->box.pos);
+				// Clear modules next to STRIP
+				std::vector<history::Action*>* h1 = groupClearSpace(l->rootJ);
+				for (history::Action* h : *h1) l->complexAction->push(h);
+				delete h1;
 
-		if (!warningLog.empty()) {
-			osdialog_message(OSDIALOG_WARNING, OSDIALOG_OK, warningLog.c_str());
-		}
+				json_t* moduleJ;
+				size_t moduleIndex;
+				if (module->mode == MODE::LEFTRIGHT || module->mode == MODE::RIGHT) {
+					json_array_foreach(json_object_get(l->rootJ, "rightModules"), moduleIndex, moduleJ) {
+						l->moduleJs.push_back(std::make_tuple(moduleJ, moduleToRackPos::RIGHT));
+					}
+				}
+				if (module->mode == MODE::LEFTRIGHT || module->mode == MODE::LEFT) {
+					json_array_foreach(json_object_get(l->rootJ, "leftModules"), moduleIndex, moduleJ) {
+						l->moduleJs.push_back(std::make_tuple(moduleJ, moduleToRackPos::LEFT));
+					}
+				}
+				l->moduleIds.reserve(l->moduleJs.size());
+				l->boxRight = l->boxLeft = this->box;
+				l->stage = GroupLoader::STAGE::MODULES;
+				return true;
+			}
 
-		history::ComplexAction* complexAction = new history::ComplexAction;
-		complexAction->name = "stoermelder STRIP selection load";
-		for (history::Action* h : *h2) complexAction->push(h);
-		delete h2;
-		for (history::Action* h : *h3) complexAction->push(h);
-		delete h3;
-		for (history::Action* h : *h4) complexAction->push(h);
-		delete h4;
-		APP->history->push(complexAction);
-	}
+			case GroupLoader::STAGE::MODULES: {
+				if (l->moduleIndex == l->moduleJs.size()) {
+					l->moduleIndex = 0;
+					l->stage = GroupLoader::STAGE::PRESETS;
+					return true;
+				}
+				json_t* moduleJ = std::get<0>(l->moduleJs[l->moduleIndex]);
+				moduleToRackPos modPos = std::get<1>(l->moduleJs[l->moduleIndex]);
+				Rect& box = modPos == moduleToRackPos::RIGHT ? l->boxRight : l->boxLeft;
+				int64_t oldId;
+				history::Action* h = groupFromJson_module(moduleJ, modPos, box, l->modules, oldId);
+				if (h) l->complexAction->push(h);
+				ModuleWidget* mw = l->modules[oldId];
+				l->moduleIds[oldId] = mw ? mw->module->id : -1;
+				l->moduleIndex++;
+				return true;
+			}
+
+			case GroupLoader::STAGE::PRESETS: {
+				// Load presets for modules, also fixes parameter mappings
+				if (l->moduleIndex == l->moduleJs.size()) {
+					l->stage = GroupLoader::STAGE::CABLES;
+					return true;
+				}
+				json_t* moduleJ = std::get<0>(l->moduleJs[l->moduleIndex]);
+				history::Action* h = groupFromJson_preset(moduleJ, l->modules);
+				if (h) l->complexAction->push(h);
+				l->moduleIndex++;
+				return true;
+			}
 
+			case GroupLoader::STAGE::CABLES: {
+				// Add cables
+				std::vector<history::Action*>* h4 = groupFromJson_cables(l->rootJ, l->modules);
+				for (history::Action* h : *h4) l->complexAction->push(h);
+				delete h4;
 
-	void groupReplaceFromJson(json_t* rootJ) {
-		warningLog = "";
+				// Does nothing, but fixes https://github.com/VCVRack/Rack/issues/1444 for Rack <= 1.1.1
+				APP->scene->rack->requestModulePos(this, this->box.pos);
 
-		std::list<std::tuple<std::string, int, PortWidget*, NVGcolor>> conn;
+				if (l->replace) {
+					// Restore cables from StripCon-modules
+					std::vector<history::Action*>* h5 = groupConnectionsRestore(l->conn);
+					for (history::Action* h : *h5) l->complexAction->push(h);
+					delete h5;
+				}
 
-		// Collect all connections outside the strip using StripCon modules
-		groupConnectionsCollect(conn);
+				APP->history->push(l->complexAction);
+				l->complexAction = NULL;
+				groupLoadEnd();
 
-		// Remove all modules adjacent to STRIP
-		groupRemove();
+				if (!warningLog.empty()) {
+					osdialog_message(OSDIALOG_WARNING, OSDIALOG_OK, warningLog.c_str());
+				}
+				return false;
+			}
+		}
+		return false;
+	}
 
-		// Clear modules next to STRIP
-		std::vector<history::Action*>* h1 = groupClearSpace(rootJ);
+	int nextOverlayMessageId() override {
+		if (!groupLoader || !groupLoaderMessage) return -1;
+		groupLoaderMessage = false;
+		return 0;
+	}
+
+	void getOverlayMessage(int id, Message& m) override {
+		if (id != 0 || !groupLoader) return;
+		GroupLoader* l = groupLoader;
+		m.title = "STRIP";
+		m.subtitle[0] = l->name;
+		size_t n = l->moduleJs.size();
+		switch (l->stage) {
+			case GroupLoader::STAGE::PARSE:
+			case GroupLoader::STAGE::CLEAR:
+				m.subtitle[1] = "Reading...";
+				break;
+			case GroupLoader::STAGE::MODULES:
+				m.subtitle[1] = string::f("Adding modules %zu/%zu", l->moduleIndex, n);
+				break;
+			case GroupLoader::STAGE::PRESETS:
+				m.subtitle[1] = string::f("Loading presets %zu/%zu", l->moduleIndex, n);
+				break;
+			case GroupLoader::STAGE::CABLES:
+				m.subtitle[1] = "Adding cables...";
+				break;
+		}
+	}
 
-		// Maps old moduleId to the newly created module (with new id)
-		std::map<int64_t, ModuleWidget*> modules;
+	void groupSelectionFromJson(json_t* rootJ) {
+		warningLog = "";
+
+		// Maps old moduleId to the newly created modules (with new id)
+		StripIdFixMap modules;
 		// Add modules
-		std::vector<history::Action*>* h2 = groupFromJson_modules(rootJ, modules);
+		std::vector<history::Action*>* h2 = groupSelectionFromJson_modules(rootJ, modules);
 		// Load presets for modules, also fixes parameter mappings
-		std::vector<history::Action*>* h3 = groupFromJson_presets(rootJ, modules);
+		std::vector<history::Action*>* h3 = groupSelectionFromJson_presets(rootJ, modules);
 
 		// Add cables
 		std::vector<history::Action*>* h4 = groupFromJson_cables(rootJ, modules);
@@ -941,50 +1067,43 @@ struct StripWidgetBase : ThemedModuleWidget<MODULE> {
 		// Does nothing, but fixes https://github.com/VCVRack/Rack/issues/1444 for Rack <= 1.1.1
 		APP->scene->rack->requestModulePos(this, this->box.pos);
 
-		// Restore cables from StripCon-modules
-		std::vector<history::Action*>* h5 = groupConnectionsRestore(conn);
-
 		if (!warningLog.empty()) {
 			osdialog_message(OSDIALOG_WARNING, OSDIALOG_OK, warningLog.c_str());
 		}
 
 		history::ComplexAction* complexAction = new history::ComplexAction;
-		complexAction->name = "stoermelder STRIP load";
-		for (history::Action* h : *h1) complexAction->push(h);
-		delete h1;
+		complexAction->name = "stoermelder STRIP selection load";
 		for (history::Action* h : *h2) complexAction->push(h);
 		delete h2;
 		for (history::Action* h : *h3) complexAction->push(h);
 		delete h3;
 		for (history::Action* h : *h4) complexAction->push(h);
 		delete h4;
-		for (history::Action* h : *h5) complexAction->push(h);
-		delete h5;
 		APP->history->push(complexAction);
 	}
 
+
 	void groupPasteClipboard() {
-		const char* moduleJson = glfwGetClipboardString(APP->window->win);
-		if (!moduleJson) {
+		if (groupLoader) return;
+		const char* moduleJsonC = glfwGetClipboardString(APP->window->win);
+		if (!moduleJsonC) {
 			osdialog_message(OSDIALOG_WARNING, OSDIALOG_OK, "Could not get text from clipboard.");
 			return;
 		}
 
-		json_error_t error;
-		json_t* rootJ = json_loads(moduleJson, 0, &error);
-		if (!rootJ) {
-			std::string message = string::f("JSON parsing error at %s %d:%d %s", error.source, error.line, error.column, error.text);
-			osdialog_message(OSDIALOG_WARNING, OSDIALOG_OK, message.c_str());
-			return;
-		}
-		DEFER({
-			json_decref(rootJ);
+		std::string moduleJson = moduleJsonC;
+		groupLoadStart("Clipboard", false, [=](std::string& message) {
+			json_error_t error;
+			json_t* rootJ = json_loads(moduleJson.c_str(), 0, &error);
+			if (!rootJ) {
+				message = string::f("JSON parsing error at %s %d:%d %s", error.source, error.line, error.column, error.text);
+			}
+			return rootJ;
 		});
-
-		groupFromJson(rootJ);
 	}
 
 	void groupSelectionPasteClipboard() {
+		if (groupLoader) return;
 		APP->scene->rack->deselectAll();
 
 		const char* moduleJson = glfwGetClipboardString(APP->window->win);
@@ -1008,34 +1127,29 @@ struct StripWidgetBase : ThemedModuleWidget<MODULE> {
 	}
 
 	void groupLoadFile(std::string filename, bool replace) {
-		INFO("Loading preset %s", filename.c_str());
-
-		FILE* file = fopen(filename.c_str(), "r");
-		if (!file) {
-			std::string message = string::f("Could not load file %s", filename.c_str());
-			osdialog_message(OSDIALOG_WARNING, OSDIALOG_OK, message.c_str());
-			return;
-		}
-		DEFER({
-			fclose(file);
-		});
+		groupLoadStart(system::getStem(filename), replace, [=](std::string& message) -> json_t* {
+			INFO("Loading preset %s", filename.c_str());
 
-		json_error_t error;
-		json_t* rootJ = json_loadf(file, 0, &error);
-		if (!rootJ) {
-			std::string message = string::f("File is not a valid file. JSON parsing error at %s %d:%d %s", error.source, error.line, error.column, error.text);
-			osdialog_message(OSDIALOG_WARNING, OSDIALOG_OK, message.c_str());
-			return;
-		}
-		DEFER({
-			json_decref(rootJ);
+			FILE* file = fopen(filename.c_str(), "r");
+			if (!file) {
+				message = string::f("Could not load file %s", filename.c_str());
+				return NULL;
+			}
+			DEFER({
+				fclose(file);
+			});
+
+			json_error_t error;
+			json_t* rootJ = json_loadf(file, 0, &error);
+			if (!rootJ) {
+				message = string::f("File is not a valid file. JSON parsing error at %s %d:%d %s", error.source, error.line, error.column, error.text);
+			}
+			return rootJ;
 		});
-
-		if (replace) groupReplaceFromJson(rootJ);
-		else groupFromJson(rootJ);
 	}
 
 	void groupLoadFileDialog(bool replace) {
+		if (groupLoader) return;
 		osdialog_filters* filters = osdialog_filters_parse(PRESET_FILTERS);
 		DEFER({
 			osdialog_filters_free(filters);
@@ -1072,6 +1186,7 @@ struct StripWidgetBase : ThemedModuleWidget<MODULE> {
 	}
 
 	void groupSelectionLoadFileDialog() {
+		if (groupLoader) return;
 		std::string selectionDir = asset::user("selections");
 		system::createDirectories(selectionDir);
 
@@ -1098,6 +1213,9 @@ struct StripWidgetBase : ThemedModuleWidget<MODULE> {
 		ModuleWidget::onHoverKey(e);
 		if (e.isConsumed())
 			return;
+		// Group actions are not available while a group is loading
+		if (groupLoader)
+			return;
 
 		if (e.action == GLFW_PRESS || e.action == GLFW_REPEAT) {
 			switch (e.key) {
@@ -1181,7 +1299,7 @@ struct StripWidgetBase : ThemedModuleWidget<MODULE> {
 				if (system::isFile(presetPath)) {
 					if (!endsWith(presetPath, ".vcvss")) continue;
 					std::string presetName = system::getStem(system::getFilename(presetPath));
-					menu->addChild(construct<PresetItem>(&MenuItem::text, presetName, &PresetItem::presetPath, presetPath, &PresetItem::module, module, &PresetItem::mw, mw));
+					menu->addChild(construct<PresetItem>(&MenuItem::text, presetName, &MenuItem::disabled, mw->groupLoader != NULL, &PresetItem::presetPath, presetPath, &PresetItem::module, module, &PresetItem::mw, mw));
 				}
 			}
 		}
@@ -38,6 +38,30 @@ enum class OUTMODE {
 	PHASE = 5
 };
 
+/** Optional timing of a bound parameter within a transition */
+struct TransitTiming {
+	/** Start of the parameter's transition as fraction of the transition time */
+	float delay = 0.f;
+	/** Duration of the parameter's transition as fraction of the remaining time */
+	float duration = 1.f;
+	/** Curve of the parameter's transition, -1 fast start, 0 linear, 1 slow start */
+	float shape = 0.f;
+
+	bool isDefault() {
+		return delay == 0.f && duration == 1.f && shape == 0.f;
+	}
+};
+
+/** Bound parameter of a running transition, resolved once when a snapshot is loaded */
+struct TransitPlanItem {
+	ParamHandle* handle;
+	/** Mapping of the handle the item has been resolved for, resolved again if the handle changes */
+	int64_t moduleId;
+	int paramId;
+	/** NULL if the handle is unmapped */
+	Param* param;
+};
+
 template <int NUM_PRESETS>
 struct TransitModule : TransitBase<NUM_PRESETS> {
 	typedef TransitBase<NUM_PRESETS> BASE;
@@ -72,14 +96,22 @@ struct TransitModule : TransitBase<NUM_PRESETS> {
 	int presetCount;
 
 	/** Total number of snapshots including expanders */
-	int presetTotal;
+	int presetTotal = NUM_PRESETS;
 	int presetNext;
 	int presetCopy = -1;
 	float presetPhaseLast = -1.f;
 
-	/** Holds the last values on transitions */
-	std::vector<float> presetOld;
-	std::vector<float> presetNew;
+	/** Holds the parameters of the current transition */
+	std::vector<TransitPlanItem> transitPlan;
+	/** Values of the current transition packed by four, in the same order as transitPlan */
+	std::vector<simd::float_4> transitOld;
+	std::vector<simd::float_4> transitNew;
+	std::vector<simd::float_4> transitValue;
+	/** Per-parameter timing of the current transition, only used if transitTimed is set */
+	std::vector<simd::float_4> transitDelay;
+	std::vector<simd::float_4> transitRate;
+	std::vector<simd::float_4> transitCurve;
+	bool transitTimed = false;
 
 	/** [Stored to JSON] mode for SEQ CV input */
 	SLOTCVMODE slotCvMode = SLOTCVMODE::TRIG_FWD;
@@ -108,6 +140,8 @@ struct TransitModule : TransitBase<NUM_PRESETS> {
 
 	/** [Stored to JSON] */
 	std::vector<ParamHandle*> sourceHandles;
+	/** [Stored to JSON] timing for each parameter in sourceHandles */
+	std::vector<TransitTiming> sourceTimings;
 
 	dsp::SchmittTrigger slotTrigger;
 	dsp::SchmittTrigger slotC4Trigger;
@@ -126,6 +160,9 @@ struct TransitModule : TransitBase<NUM_PRESETS> {
 	int sampleRate;
 
 	TransitBase<NUM_PRESETS>* N[MAX_EXPANDERS + 1];
+	/** Settings last passed on to the expanders */
+	CTRLMODE expanderCtrlMode = CTRLMODE::READ;
+	int expanderPanelTheme = -1;
 	
 	TaskProcessor<> taskProcessorUi;
 
@@ -149,6 +186,7 @@ struct TransitModule : TransitBase<NUM_PRESETS> {
 
 		handleDivider.setDivision(4096);
 		lightDivider.setDivision(512);
+		N[0] = this;
 		buttonDivider.setDivision(128);
 		reset(true);
 	}
@@ -173,12 +211,21 @@ struct TransitModule : TransitBase<NUM_PRESETS> {
 					delete sourceHandle;
 				}
 				sourceHandles.clear();
+				sourceTimings.clear();
+				transitPlan.clear();
+				transitOld.clear();
+				transitNew.clear();
+				transitValue.clear();
+				transitDelay.clear();
+				transitRate.clear();
+				transitCurve.clear();
+				processing = false;
 				inChange = false;
 			};
 
 			// Enqueue on the UI-thread as the engine's mutex could already be locked
 			if (createUiTask) {
-				taskProcessorUi.enqueue(cleanHandles);
+				taskProcessorUi.enqueue(std::move(cleanHandles));
 			}
 			else {
 				cleanHandles();
@@ -236,14 +283,18 @@ struct TransitModule : TransitBase<NUM_PRESETS> {
 		return &N[n]->textLabel[index % NUM_PRESETS];
 	}
 
-	void process(const Module::ProcessArgs& args) override {
-		if (inChange) return;
-		sampleRate = args.sampleRate;
+	/**
+	 * Resolves the chain of expanders, only called if the chain has changed
+	 * or the settings must be passed on to the expanders.
+	 */
+	void expanderUpdate() {
+		BASE::expanderChanged = false;
+		expanderCtrlMode = BASE::ctrlMode;
+		expanderPanelTheme = BASE::panelTheme;
 
 		presetTotal = NUM_PRESETS;
 		Module* m = this;
 		TransitBase<NUM_PRESETS>* t = this;
-		t->ctrlMode = (CTRLMODE)Module::params[PARAM_CTRLMODE].getValue();
 		int c = 0;
 		while (true) {
 			N[c] = t;
@@ -262,6 +313,19 @@ struct TransitModule : TransitBase<NUM_PRESETS> {
 			t->ctrlMode = BASE::ctrlMode;
 			presetTotal += NUM_PRESETS;
 		}
+	}
+
+	void process(const Module::ProcessArgs& args) override {
+		if (inChange) return;
+		sampleRate = args.sampleRate;
+
+		BASE::ctrlMode = (CTRLMODE)Module::params[PARAM_CTRLMODE].getValue();
+		if (BASE::ctrlMode != expanderCtrlMode || BASE::panelTheme != expanderPanelTheme) {
+			BASE::expanderChanged = true;
+		}
+		if (BASE::expanderChanged) {
+			expanderUpdate();
+		}
 		int presetCount = std::min(this->presetCount, presetTotal);
 
 		if (handleDivider.process()) {
@@ -506,6 +570,7 @@ struct TransitModule : TransitBase<NUM_PRESETS> {
 		APP->engine->updateParamHandle(sourceHandle, moduleId, paramId, true);
 		inChange = true;
 		sourceHandles.push_back(sourceHandle);
+		sourceTimings.push_back(TransitTiming());
 		inChange = false;
 
 		ParamQuantity* pq = getParamQuantity(sourceHandle);
@@ -546,15 +611,35 @@ struct TransitModule : TransitBase<NUM_PRESETS> {
 				outSocPulseGenerator.trigger();
 				outEocArm = true;
 				processing = true;
-				presetOld.clear();
-				presetNew.clear();
-				for (size_t i = 0; i < sourceHandles.size(); i++) {
-					ParamQuantity* pq = getParamQuantity(sourceHandles[i]);
-					presetOld.push_back(pq ? pq->getValue() : 0.f);
-					if (slot->preset->size() > i) {
-						presetNew.push_back((*(slot->preset))[i]);
+				transitPlan.clear();
+				transitOld.clear();
+				transitNew.clear();
+				transitDelay.clear();
+				transitRate.clear();
+				transitCurve.clear();
+				transitTimed = false;
+				for (size_t i = 0; i < sourceHandles.size() && i < slot->preset->size(); i++) {
+					ParamHandle* handle = sourceHandles[i];
+					ParamQuantity* pq = getParamQuantity(handle);
+					if (!pq) continue;
+					TransitTiming timing = i < sourceTimings.size() ? sourceTimings[i] : TransitTiming();
+					size_t n = transitPlan.size();
+					if (n % 4 == 0) {
+						transitOld.push_back(simd::float_4(0.f));
+						transitNew.push_back(simd::float_4(0.f));
+						transitDelay.push_back(simd::float_4(0.f));
+						transitRate.push_back(simd::float_4(1.f));
+						transitCurve.push_back(simd::float_4(1.f));
 					}
+					transitOld[n / 4][n % 4] = pq->getValue();
+					transitNew[n / 4][n % 4] = (*(slot->preset))[i];
+					transitDelay[n / 4][n % 4] = timing.delay;
+					transitRate[n / 4][n % 4] = 1.f / std::max((1.f - timing.delay) * timing.duration, 1e-3f);
+					transitCurve[n / 4][n % 4] = std::pow(4.f, timing.shape);
+					transitTimed |= !timing.isDefault();
+					transitPlan.push_back(TransitPlanItem{handle, handle->moduleId, handle->paramId, pq->getParam()});
 				}
+				transitValue.resize(transitNew.size());
 			}
 		}
 		else {
@@ -613,17 +698,28 @@ struct TransitModule : TransitBase<NUM_PRESETS> {
 			}
 
 			float s10 = s / 10.f;
-			for (size_t i = 0; i < sourceHandles.size(); i++) {
-				ParamQuantity* pq = getParamQuantity(sourceHandles[i]);
-				if (!pq) continue;
-				if (presetOld.size() <= i) return;
-				float oldValue = presetOld[i];
-				if (presetNew.size() <= i) return;
-				float newValue = presetNew[i];
-				float v = crossfade(oldValue, newValue, s10);
-				if (s10 > (1.f - 5e-3f) && std::abs(std::round(v) - v) < 5e-3f) v = std::round(v);
-				//pq->setValue(v);
-				pq->getParam()->setValue(v);
+			// Crossfade four parameters at once, snap to integers at the end of the transition
+			simd::float_4 s4 = s10;
+			for (size_t k = 0; k < transitNew.size(); k++) {
+				simd::float_4 p = s4;
+				if (transitTimed) {
+					// Each parameter finishes within the global transition, delayed and curved on its own
+					p = simd::clamp((s4 - transitDelay[k]) * transitRate[k], 0.f, 1.f);
+					p = simd::pow(p, transitCurve[k]);
+				}
+				simd::float_4 v = transitOld[k] + (transitNew[k] - transitOld[k]) * p;
+				simd::float_4 r = simd::round(v);
+				v = simd::ifelse((p > 1.f - 5e-3f) & (r - v < 5e-3f) & (v - r < 5e-3f), r, v);
+				transitValue[k] = v;
+			}
+			for (size_t i = 0; i < transitPlan.size(); i++) {
+				TransitPlanItem& item = transitPlan[i];
+				if (item.handle->moduleId != item.moduleId || item.handle->paramId != item.paramId) {
+					transitPlanResolve(i);
+				}
+				// Skip parameters which have been unmapped meanwhile
+				if (!item.param) continue;
+				item.param->setValue(transitValue[i / 4][i % 4]);
 			}
 
 			if (s == 10.f) {
@@ -632,6 +728,21 @@ struct TransitModule : TransitBase<NUM_PRESETS> {
 		}
 	}
 
+	/**
+	 * Resolves an item of the running transition again after its handle has been removed or
+	 * remapped, a remapped parameter continues the transition from its current value.
+	 */
+	void transitPlanResolve(size_t i) {
+		TransitPlanItem& item = transitPlan[i];
+		ParamQuantity* pq = getParamQuantity(item.handle);
+		item.moduleId = item.handle->moduleId;
+		item.paramId = item.handle->paramId;
+		item.param = pq ? pq->getParam() : NULL;
+		if (!pq) return;
+		transitOld[i / 4][i % 4] = pq->getValue();
+		transitValue[i / 4][i % 4] = pq->getValue();
+	}
+
 	void presetProcessPhase(float sampleTime) {
 		if (presetProcessDivider.process()) {
 			preset = -1;
@@ -852,6 +963,13 @@ struct TransitModule : TransitBase<NUM_PRESETS> {
 			json_t* sourceMapJ = json_object();
 			json_object_set_new(sourceMapJ, "moduleId", json_integer(sourceHandles[i]->moduleId));
 			json_object_set_new(sourceMapJ, "paramId", json_integer(sourceHandles[i]->paramId));
+			if (i < sourceTimings.size() && !sourceTimings[i].isDefault()) {
+				json_t* timingJ = json_object();
+				json_object_set_new(timingJ, "delay", json_real(sourceTimings[i].delay));
+				json_object_set_new(timingJ, "duration", json_real(sourceTimings[i].duration));
+				json_object_set_new(timingJ, "shape", json_real(sourceTimings[i].shape));
+				json_object_set_new(sourceMapJ, "timing", timingJ);
+			}
 			json_array_append_new(sourceMapsJ, sourceMapJ);
 		}
 		json_object_set_new(rootJ, "sourceMaps", sourceMapsJ);
@@ -874,6 +992,14 @@ struct TransitModule : TransitBase<NUM_PRESETS> {
 		}
 
 		inChange = true;
+		transitPlan.clear();
+		transitOld.clear();
+		transitNew.clear();
+		transitValue.clear();
+		transitDelay.clear();
+		transitRate.clear();
+		transitCurve.clear();
+		processing = false;
 		std::list<std::function<void()>> handleList;
 
 		json_t* sourceMapsJ = json_object_get(rootJ, "sourceMaps");
@@ -886,6 +1012,13 @@ struct TransitModule : TransitBase<NUM_PRESETS> {
 				json_t* paramIdJ = json_object_get(sourceMapJ, "paramId");
 				int paramId = json_integer_value(paramIdJ);
 				moduleId = BASE::idFix(moduleId);
+				TransitTiming timing;
+				json_t* timingJ = json_object_get(sourceMapJ, "timing");
+				if (timingJ) {
+					timing.delay = clamp((float)json_real_value(json_object_get(timingJ, "delay")), 0.f, 0.99f);
+					timing.duration = clamp((float)json_real_value(json_object_get(timingJ, "duration")), 0.01f, 1.f);
+					timing.shape = clamp((float)json_real_value(json_object_get(timingJ, "shape")), -1.f, 1.f);
+				}
 
 				// This might cause a deadlock as the engine's mutex could already be locked
 				handleList.push_back([=]() {
@@ -894,6 +1027,7 @@ struct TransitModule : TransitBase<NUM_PRESETS> {
 					APP->engine->addParamHandle(sourceHandle);
 					APP->engine->updateParamHandle(sourceHandle, moduleId, paramId, false);
 					sourceHandles.push_back(sourceHandle);
+					sourceTimings.push_back(timing);
 				});
 			}
 		}
@@ -911,6 +1045,55 @@ struct TransitModule : TransitBase<NUM_PRESETS> {
 	}
 };
 
+struct TransitTimingSlider : ui::Slider {
+	struct TimingQuantity : Quantity {
+		float* p;
+		std::string label;
+		float minValue;
+		float maxValue;
+		float defaultValue;
+		float displayMultiplier = 100.f;
+		void setValue(float value) override {
+			*p = clamp(value, minValue, maxValue);
+		}
+		float getValue() override {
+			return *p;
+		}
+		float getDefaultValue() override {
+			return defaultValue;
+		}
+		float getDisplayValue() override {
+			return getValue() * displayMultiplier;
+		}
+		void setDisplayValue(float displayValue) override {
+			setValue(displayValue / displayMultiplier);
+		}
+		std::string getLabel() override {
+			return label;
+		}
+		std::string getUnit() override {
+			return displayMultiplier == 100.f ? "%" : "";
+		}
+		int getDisplayPrecision() override {
+			return 2;
+		}
+		float getMaxValue() override {
+			return maxValue;
+		}
+		float getMinValue() override {
+			return minValue;
+		}
+	}; // struct TimingQuantity
+
+	TransitTimingSlider(float* p, std::string label, float minValue, float maxValue, float defaultValue, float displayMultiplier = 100.f) {
+		box.size.x = 220.0f;
+		quantity = construct<TimingQuantity>(&TimingQuantity::p, p, &TimingQuantity::label, label, &TimingQuantity::minValue, minValue, &TimingQuantity::maxValue, maxValue, &TimingQuantity::defaultValue, defaultValue, &TimingQuantity::displayMultiplier, displayMultiplier);
+	}
+	~TransitTimingSlider() {
+		delete quantity;
+	}
+}; // struct TransitTimingSlider
+
 template <int NUM_PRESETS>
 struct TransitWidget : ThemedModuleWidget<TransitModule<NUM_PRESETS>> {
 	typedef TransitWidget<NUM_PRESETS> WIDGET;
@@ -1193,6 +1376,7 @@ struct TransitWidget : ThemedModuleWidget<TransitModule<NUM_PRESETS>> {
 
 				MODULE* module;
 				ParamHandle* handle;
+				size_t id;
 				ParameterItem() {
 					rightText = RIGHT_ARROW;
 				}
@@ -1200,6 +1384,14 @@ struct TransitWidget : ThemedModuleWidget<TransitModule<NUM_PRESETS>> {
 					Menu* menu = new Menu;
 					menu->addChild(construct<IndicateItem>(&MenuItem::text, "Locate and indicate", &IndicateItem::module, module, &IndicateItem::handle, handle));
 					menu->addChild(construct<UnbindItem>(&MenuItem::text, "Unbind", &UnbindItem::module, module, &UnbindItem::handle, handle));
+					if (id < module->sourceTimings.size()) {
+						TransitTiming* timing = &module->sourceTimings[id];
+						menu->addChild(new MenuSeparator);
+						menu->addChild(construct<MenuLabel>(&MenuLabel::text, "Timing"));
+						menu->addChild(new TransitTimingSlider(&timing->delay, "Delay", 0.f, 0.99f, 0.f));
+						menu->addChild(new TransitTimingSlider(&timing->duration, "Duration", 0.01f, 1.f, 1.f));
+						menu->addChild(new TransitTimingSlider(&timing->shape, "Shape", -1.f, 1.f, 0.f, 1.f));
+					}
 					return menu;
 				}
 			};
@@ -1219,7 +1411,7 @@ struct TransitWidget : ThemedModuleWidget<TransitModule<NUM_PRESETS>> {
 					if (!paramWidget) continue;
 					
 					std::string text = string::f("%s %s", moduleWidget->model->name.c_str(), paramWidget->getParamQuantity()->getLabel().c_str());
-					menu->addChild(construct<ParameterItem>(&MenuItem::text, text, &ParameterItem::module, module, &ParameterItem::handle, handle));
+					menu->addChild(construct<ParameterItem>(&MenuItem::text, text, &ParameterItem::module, module, &ParameterItem::handle, handle, &ParameterItem::id, i));
 				}
 				return menu;
 			}
@@ -48,6 +48,8 @@ struct TransitBase : Module, StripIdFixModule {
 
 	int64_t ctrlModuleId = -1;
 	int ctrlOffset = 0;
+	/** Set if the chain of expanders must be resolved again */
+	bool expanderChanged = true;
 	CTRLMODE ctrlMode = CTRLMODE::READ;
 
 	TransitSlot slot[NUM_PRESETS];
@@ -56,6 +58,19 @@ struct TransitBase : Module, StripIdFixModule {
 
 	virtual int transitSlotCmd(SLOT_CMD cmd, int i) { return -1; }
 
+	void onExpanderChange(const Module::ExpanderChangeEvent& e) override {
+		// Only the direct neighbours get notified, pass the change on to the
+		// controlling module on the left end of the chain
+		Module* m = this;
+		while (m->model == modelTransitEx) {
+			m = m->leftExpander.module;
+			if (!m) return;
+		}
+		if (m->model == modelTransit) {
+			reinterpret_cast<TransitBase<NUM_PRESETS>*>(m)->expanderChanged = true;
+		}
+	}
+
 	json_t* dataToJson() override {
 		json_t* rootJ = json_object();
 		json_object_set_new(rootJ, "panelTheme", json_integer(TransitBase<NUM_PRESETS>::panelTheme));
@@ -84,6 +84,10 @@ struct LinearFade {
 		setFall(fall);
 	}
 
+	inline bool isActive() {
+		return currentRise < rise || currentFall > 0.f;
+	}
+
 	inline float process(float deltaTime) {
 		if (currentRise < rise) {
 			currentRise += deltaTime;
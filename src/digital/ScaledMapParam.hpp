@@ -123,6 +123,11 @@ struct ScaledMapParam {
 		}
 	}
 
+	/** Returns true if the slew limiter has not reached the target value yet */
+	bool isSlewing() {
+		return filterSlew > 0.f && filterInitialized && filter.out != value;
+	}
+
 	T getValue() {
 		float f = paramQuantity->getScaledValue();
 		if (isNear(valueOut, f)) return valueIn;
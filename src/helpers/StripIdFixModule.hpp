@@ -1,16 +1,20 @@
 #pragma once
+#include <unordered_map>
+
+/** Maps module ids of a loaded strip to the newly created modules, NULL if a module is missing */
+typedef std::unordered_map<int64_t, ModuleWidget*> StripIdFixMap;
 
 struct StripIdFixModule {
-	const std::map<int64_t, ModuleWidget*>* idFixMap = NULL;
+	const StripIdFixMap* idFixMap = NULL;
 
-	void idFixDataFromJson(const std::map<int64_t, ModuleWidget*>& moduleIdMapping) {
+	void idFixDataFromJson(const StripIdFixMap& moduleIdMapping) {
 		this->idFixMap = &moduleIdMapping;
 	}
 
 	int64_t idFix(int64_t moduleId) {
 		if (!this->idFixMap) return moduleId;
 		auto it = this->idFixMap->find(moduleId);
-		if (it == this->idFixMap->end()) return -1;
+		if (it == this->idFixMap->end() || !it->second) return -1;
 		return it->second->module->id;
 	}
 	
@@ -1,24 +1,77 @@
 #pragma once
 #include "../plugin.hpp"
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <type_traits>
 
 namespace StoermelderPackOne {
 
-template<size_t SIZE = 8>
+/**
+ * Single-producer single-consumer queue of tasks, usually filled on the engine thread
+ * and processed on the UI thread. Tasks are stored inline in a fixed number of slots
+ * of STORAGE bytes each, so enqueuing never allocates memory.
+ */
+template<size_t SIZE = 8, size_t STORAGE = 64>
 struct TaskProcessor {
-    dsp::RingBuffer<std::function<void()>, SIZE> queue;
+    struct Task {
+        alignas(std::max_align_t) unsigned char storage[STORAGE];
+        void (*invoke)(void*);
+        void (*destroy)(void*);
+    };
+
+    Task tasks[SIZE];
+    std::atomic<size_t> start{0};
+    std::atomic<size_t> end{0};
+    /** Number of tasks which could not be enqueued as the queue was full */
+    std::atomic<uint32_t> droppedCount{0};
+    uint32_t droppedReported = 0;
+
+    ~TaskProcessor() {
+        size_t s = start.load(std::memory_order_relaxed);
+        size_t e = end.load(std::memory_order_relaxed);
+        for (; s != e; s++) {
+            Task& t = tasks[s % SIZE];
+            t.destroy(t.storage);
+        }
+    }
 
     void process() {
-        while (queue.size() > 0) {
-            std::function<void()> t = queue.shift();
-            t();
+        size_t s = start.load(std::memory_order_relaxed);
+        while (s != end.load(std::memory_order_acquire)) {
+            Task& t = tasks[s % SIZE];
+            t.invoke(t.storage);
+            t.destroy(t.storage);
+            s++;
+            start.store(s, std::memory_order_release);
+        }
+
+        uint32_t dropped = droppedCount.load(std::memory_order_relaxed);
+        if (dropped != droppedReported) {
+            WARN("TaskProcessor: %u task(s) dropped, queue is full", dropped - droppedReported);
+            droppedReported = dropped;
         }
     }
 
-    void enqueue(std::function<void()> t) {
-        if (!queue.full()) {
-            queue.push(t);
+    /** Enqueues a callable object, returns false if the queue is full */
+    template<typename F>
+    bool enqueue(F&& f) {
+        typedef typename std::decay<F>::type T;
+        static_assert(sizeof(T) <= STORAGE, "Task exceeds the inline storage of TaskProcessor");
+        static_assert(alignof(T) <= alignof(std::max_align_t), "Task is over-aligned for TaskProcessor");
+
+        size_t e = end.load(std::memory_order_relaxed);
+        if (e - start.load(std::memory_order_acquire) >= SIZE) {
+            droppedCount.fetch_add(1, std::memory_order_relaxed);
+            return false;
         }
+        Task& t = tasks[e % SIZE];
+        new (t.storage) T(std::forward<F>(f));
+        t.invoke = [](void* p) { (*reinterpret_cast<T*>(p))(); };
+        t.destroy = [](void* p) { reinterpret_cast<T*>(p)->~T(); };
+        end.store(e + 1, std::memory_order_release);
+        return true;
     }
 }; // struct TaskProcessor
 
-} // namespace StoermelderPackOne
\ No newline at end of file
+} // namespace StoermelderPackOne
@@ -1,51 +1,287 @@
 #pragma once
 #include "../plugin.hpp"
 #include <functional>
+#include <future>
+#include <memory>
+#include <deque>
+#include <thread>
 #include <mutex>
+#include <atomic>
 #include <condition_variable>
 
 namespace StoermelderPackOne {
 
+enum class TASKPRIORITY {
+	HIGH = 0,
+	NORMAL = 1
+};
+
+struct TaskWorker;
+
+/**
+ * Plugin-wide pool of worker threads shared by all TaskWorkers. The pool queues
+ * TaskWorkers which have pending tasks, each TaskWorker is queued at most once
+ * so its tasks run one after another in the order of submission.
+ * The pool is created by init() and never destroyed, its threads are detached as
+ * joining them from a static destructor is unsafe on Windows and in static builds.
+ */
+struct TaskPool {
+	static const size_t QUEUE_SIZE = 256;
+
+	std::mutex mutex;
+	std::condition_variable condVar;
+	std::condition_variable condVarFull;
+
+	/** Bounded queues of TaskWorkers with pending tasks, one per priority */
+	TaskWorker* queue[2][QUEUE_SIZE];
+	size_t queueStart[2] = {0, 0};
+	size_t queueSize[2] = {0, 0};
+
+	TaskPool() {
+		int n = clamp((int)std::thread::hardware_concurrency() / 2, 2, 4);
+		for (int i = 0; i < n; i++) {
+			std::thread(&TaskPool::processWorker, this).detach();
+		}
+	}
+
+	static TaskPool* instance() {
+		static TaskPool* pool = new TaskPool;
+		return pool;
+	}
+
+	/**
+	 * Queues a TaskWorker, waits if the queue is full instead of dropping it.
+	 * Must not be called by the threads of the pool as they drain the queue.
+	 */
+	void push(TaskWorker* w, TASKPRIORITY priority) {
+		std::unique_lock<std::mutex> lock(mutex);
+		int q = (int)priority;
+		condVarFull.wait(lock, [&]() { return queueSize[q] < QUEUE_SIZE; });
+		enqueue(w, q);
+		lock.unlock();
+		condVar.notify_one();
+	}
+
+	/** Queues a TaskWorker if there is space, used by the threads of the pool */
+	bool requeue(TaskWorker* w, TASKPRIORITY priority) {
+		std::unique_lock<std::mutex> lock(mutex);
+		int q = (int)priority;
+		if (queueSize[q] == QUEUE_SIZE) return false;
+		enqueue(w, q);
+		lock.unlock();
+		condVar.notify_one();
+		return true;
+	}
+
+	/** Queues a TaskWorker without waiting, returns false if the pool is busy or full */
+	bool tryPush(TaskWorker* w, TASKPRIORITY priority) {
+		std::unique_lock<std::mutex> lock(mutex, std::try_to_lock);
+		int q = (int)priority;
+		if (!lock.owns_lock() || queueSize[q] == QUEUE_SIZE) return false;
+		enqueue(w, q);
+		lock.unlock();
+		condVar.notify_one();
+		return true;
+	}
+
+	/** Appends a TaskWorker to queue q, mutex must be held and the queue must not be full */
+	void enqueue(TaskWorker* w, int q) {
+		queue[q][(queueStart[q] + queueSize[q]) % QUEUE_SIZE] = w;
+		queueSize[q]++;
+	}
+
+	/** Removes a TaskWorker from the queues, returns true if it has been queued */
+	bool remove(TaskWorker* w) {
+		std::lock_guard<std::mutex> lock(mutex);
+		bool found = false;
+		for (int q = 0; q < 2; q++) {
+			size_t n = 0;
+			for (size_t i = 0; i < queueSize[q]; i++) {
+				TaskWorker* v = queue[q][(queueStart[q] + i) % QUEUE_SIZE];
+				if (v == w) {
+					found = true;
+					continue;
+				}
+				queue[q][(queueStart[q] + n) % QUEUE_SIZE] = v;
+				n++;
+			}
+			queueSize[q] = n;
+		}
+		condVarFull.notify_all();
+		return found;
+	}
+
+	void processWorker();
+}; // struct TaskPool
+
+
+/**
+ * Runs tasks of a module on the plugin-wide TaskPool. Tasks of the same TaskWorker
+ * never run concurrently and are never dropped, tasks of different TaskWorkers
+ * run in parallel. The engine thread must use post() instead of work().
+ */
 struct TaskWorker {
+	static const size_t TASKS_MAX = 64;
+
+	struct Task {
+		std::shared_ptr<std::packaged_task<void()>> task;
+		TASKPRIORITY priority;
+	};
+
+	Context* workerContext;
 	std::mutex workerMutex;
 	std::condition_variable workerCondVar;
-	std::thread* worker;
-	Context* workerContext;
+	std::deque<Task> tasks;
+	/** Set while the TaskWorker is queued in the pool or one of its tasks is running */
+	bool workerIsScheduled = false;
 	bool workerIsRunning = true;
-	bool workerDoProcess = false;
-	int workerPreset = -1;
-	std::function<void()> workerTask;
+
+	/** Handles values of post(), set before the first call of post() */
+	std::function<void(int)> postHandler;
+	/** Latest posted value not handled yet, -1 if there is none */
+	std::atomic<int> postValue{-1};
+	/** Set if post() could not queue the TaskWorker without blocking */
+	std::atomic<bool> postRetry{false};
 
 	TaskWorker() {
 		workerContext = contextGet();
-		worker = new std::thread(&TaskWorker::processWorker, this);
 	}
 
 	~TaskWorker() {
-		workerIsRunning = false;
-		workerDoProcess = true;
-		workerCondVar.notify_one();
-		worker->join();
-		workerContext = NULL;
-		delete worker;
+		stop();
+	}
+
+	/**
+	 * Discards pending tasks and waits for a running task, no tasks are run afterwards.
+	 * Owners whose tasks access their state call it first in their destructor.
+	 */
+	void stop() {
+		{
+			std::lock_guard<std::mutex> lock(workerMutex);
+			workerIsRunning = false;
+			// Pending tasks belong to the module being destroyed, only a running task is awaited
+			tasks.clear();
+		}
+		workerCondVar.notify_all();
+		std::unique_lock<std::mutex> lock(workerMutex);
+		if (TaskPool::instance()->remove(this)) {
+			workerIsScheduled = false;
+			return;
+		}
+		workerCondVar.wait(lock, [&]() { return !workerIsScheduled; });
+	}
+
+	/**
+	 * Queues a task, the returned future becomes ready after the task has finished.
+	 * Waits while TASKS_MAX tasks are pending.
+	 */
+	std::future<void> work(std::function<void()> task, TASKPRIORITY priority = TASKPRIORITY::NORMAL) {
+		auto t = std::make_shared<std::packaged_task<void()>>(task);
+		std::future<void> f = t->get_future();
+		std::unique_lock<std::mutex> lock(workerMutex);
+		workerCondVar.wait(lock, [&]() { return tasks.size() < TASKS_MAX || !workerIsRunning; });
+		if (!workerIsRunning) return f;
+		// High priority tasks are moved in front of pending normal priority tasks
+		auto it = tasks.end();
+		if (priority == TASKPRIORITY::HIGH) {
+			it = tasks.begin();
+			while (it != tasks.end() && it->priority == TASKPRIORITY::HIGH) it++;
+		}
+		tasks.insert(it, Task{t, priority});
+		if (workerIsScheduled) return f;
+		workerIsScheduled = true;
+		lock.unlock();
+		schedule(priority);
+		return f;
+	}
+
+	/**
+	 * Hands a value to postHandler, a value which has not been handled yet is replaced.
+	 * Does not allocate and does not block, so it can be called from the engine thread.
+	 */
+	void post(int value) {
+		postValue.store(value);
+		postSchedule();
+	}
+
+	/** Queues the TaskWorker if post() could not, call periodically from the posting thread */
+	void postPoll() {
+		if (postRetry.load()) postSchedule();
+	}
+
+	void postSchedule() {
+		std::unique_lock<std::mutex> lock(workerMutex, std::try_to_lock);
+		if (!lock.owns_lock()) {
+			postRetry.store(true);
+			return;
+		}
+		// A scheduled TaskWorker checks postValue before it is unscheduled
+		if (workerIsScheduled || !workerIsRunning) {
+			postRetry.store(false);
+			return;
+		}
+		if (!TaskPool::instance()->tryPush(this, TASKPRIORITY::NORMAL)) {
+			postRetry.store(true);
+			return;
+		}
+		workerIsScheduled = true;
+		postRetry.store(false);
 	}
 
-	void processWorker() {
+	/**
+	 * Runs a posted value or the next pending task, called by a thread of the pool.
+	 * The TaskWorker is queued again for its remaining tasks, if the queue of the pool
+	 * is full they are run on the current thread instead of waiting for space.
+	 */
+	void processNext() {
 		contextSet(workerContext);
+		std::unique_lock<std::mutex> lock(workerMutex);
 		while (true) {
-			std::unique_lock<std::mutex> lock(workerMutex);
-			workerCondVar.wait(lock, std::bind(&TaskWorker::workerDoProcess, this));
-			if (!workerIsRunning) return;
-			workerTask();
-			workerDoProcess = false;
+			int value = postValue.exchange(-1);
+			if (value >= 0 && workerIsRunning) {
+				lock.unlock();
+				postHandler(value);
+				lock.lock();
+			}
+			else if (!tasks.empty()) {
+				Task t = tasks.front();
+				tasks.pop_front();
+				workerCondVar.notify_all();
+				lock.unlock();
+				(*t.task)();
+				lock.lock();
+			}
+
+			if (tasks.empty() && (postValue.load() < 0 || !workerIsRunning)) {
+				workerIsScheduled = false;
+				workerCondVar.notify_all();
+				return;
+			}
+			TASKPRIORITY priority = tasks.empty() ? TASKPRIORITY::NORMAL : tasks.front().priority;
+			lock.unlock();
+			if (TaskPool::instance()->requeue(this, priority)) return;
+			lock.lock();
 		}
 	}
 
-	void work(std::function<void()> task) {
-		workerTask = task;
-		workerDoProcess = true;
-		workerCondVar.notify_one();
+	void schedule(TASKPRIORITY priority) {
+		TaskPool::instance()->push(this, priority);
 	}
 }; // struct TaskWorker
 
-} // namespace StoermelderPackOne
\ No newline at end of file
+
+inline void TaskPool::processWorker() {
+	while (true) {
+		std::unique_lock<std::mutex> lock(mutex);
+		condVar.wait(lock, [&]() { return queueSize[0] > 0 || queueSize[1] > 0; });
+		int q = queueSize[0] > 0 ? 0 : 1;
+		TaskWorker* w = queue[q][queueStart[q]];
+		queueStart[q] = (queueStart[q] + 1) % QUEUE_SIZE;
+		queueSize[q]--;
+		lock.unlock();
+		condVarFull.notify_one();
+		w->processNext();
+	}
+}
+
+} // namespace StoermelderPackOne
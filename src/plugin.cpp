@@ -1,4 +1,5 @@
 #include "plugin.hpp"
+#include "helpers/TaskWorker.hpp"
 
 Plugin* pluginInstance;
 
@@ -60,6 +61,7 @@ void init(rack::Plugin* p) {
 	p->addModel(modelMe);
 
 	pluginSettings.readFromJson();
+	StoermelderPackOne::TaskPool::instance();
 }
 
 